@@ -0,0 +1,356 @@
+#include "analysis_cache.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+static const uint32_t Magic = 0x42455346; // "BESF"
+
+// Bumped whenever fragments or hashed properties of functions change
+static const uint32_t FormatVersion = 4;
+
+static void writeIndex(std::ostream &out, uint64_t value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static bool readIndex(std::istream &in, uint64_t &value)
+{
+    return bool(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+template <typename T>
+static void writeArray(std::ostream &out, const std::vector<T> &array)
+{
+    writeIndex(out, array.size());
+    out.write(reinterpret_cast<const char *>(array.data()), array.size() * sizeof(T));
+}
+
+// whether stream has at least `amount' items of `item_size' bytes left, so
+// sizes read from a corrupt or truncated entry aren't allocated
+static bool remains(std::istream &in, uint64_t amount, uint64_t item_size)
+{
+    auto position = in.tellg();
+    if (position < 0 || !in.seekg(0, std::ios::end))
+    {
+        return false;
+    }
+    auto end = in.tellg();
+    in.seekg(position);
+    return in && end >= position && amount <= uint64_t(end - position) / item_size;
+}
+
+template <typename T>
+static bool readArray(std::istream &in, std::vector<T> &array)
+{
+    uint64_t size = 0;
+    if (!readIndex(in, size) || !remains(in, size, sizeof(T)))
+    {
+        return false;
+    }
+    array.resize(size);
+    return bool(in.read(reinterpret_cast<char *>(array.data()), size * sizeof(T)));
+}
+
+static void writeStrings(std::ostream &out, const std::vector<std::string> &strings)
+{
+    writeIndex(out, strings.size());
+    for (auto &str : strings)
+    {
+        writeIndex(out, str.size());
+        out.write(str.data(), str.size());
+    }
+}
+
+static bool readStrings(std::istream &in, std::vector<std::string> &strings)
+{
+    uint64_t size = 0;
+    if (!readIndex(in, size))
+    {
+        return false;
+    }
+    strings.clear();
+    for (uint64_t i = 0; i < size; i++)
+    {
+        uint64_t length = 0;
+        if (!readIndex(in, length) || !remains(in, length, 1))
+        {
+            return false;
+        }
+        std::string str(length, '\0');
+        if (!in.read(&str[0], length))
+        {
+            return false;
+        }
+        strings.push_back(str);
+    }
+    return true;
+}
+
+void FunctionFragment::write(std::ostream &out) const
+{
+    out.write(reinterpret_cast<const char *>(&Magic), sizeof(Magic));
+    out.write(reinterpret_cast<const char *>(&FormatVersion), sizeof(FormatVersion));
+    writeArray(out, offsets);
+    writeArray(out, targets);
+    writeArray(out, call_blocks);
+    writeStrings(out, callees);
+    writeStrings(out, call_types);
+    writeArray(out, leading_calls);
+    writeArray(out, label_blocks);
+    writeStrings(out, labels);
+    writeArray(out, label_calls);
+    writeArray(out, costs);
+    writeIndex(out, bounded_loops.size());
+    for (auto &loop : bounded_loops)
+    {
+        writeArray(out, loop);
+    }
+    writeArray(out, loop_trip_counts);
+}
+
+bool FunctionFragment::read(std::istream &in)
+{
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!in.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != Magic ||
+        !in.read(reinterpret_cast<char *>(&version), sizeof(version)) || version != FormatVersion)
+    {
+        return false;
+    }
+    uint64_t amt_loops = 0;
+    if (!readArray(in, offsets) || !readArray(in, targets) ||
+        !readArray(in, call_blocks) || !readStrings(in, callees) ||
+        !readStrings(in, call_types) || !readArray(in, leading_calls) ||
+        !readArray(in, label_blocks) || !readStrings(in, labels) ||
+        !readArray(in, label_calls) || !readArray(in, costs) || !readIndex(in, amt_loops) ||
+        !remains(in, amt_loops, sizeof(uint64_t)))
+    {
+        return false;
+    }
+    bounded_loops.resize(amt_loops);
+    for (auto &loop : bounded_loops)
+    {
+        if (!readArray(in, loop))
+        {
+            return false;
+        }
+    }
+    if (!readArray(in, loop_trip_counts))
+    {
+        return false;
+    }
+
+    // reject arrays which don't form a fragment
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != targets.size() ||
+        call_blocks.size() != callees.size() || call_blocks.size() != call_types.size() ||
+        label_blocks.size() != labels.size() || label_blocks.size() != label_calls.size() ||
+        costs.size() != size() + call_blocks.size() + label_blocks.size() ||
+        bounded_loops.size() != loop_trip_counts.size() ||
+        !std::is_sorted(call_blocks.begin(), call_blocks.end()) ||
+        !std::is_sorted(label_blocks.begin(), label_blocks.end()))
+    {
+        return false;
+    }
+    for (Index b = 0; b + 1 < offsets.size(); b++)
+    {
+        if (offsets[b] > offsets[b + 1])
+        {
+            return false;
+        }
+    }
+    auto inside = [&](const std::vector<Index> &blocks) {
+        for (Index b : blocks)
+        {
+            if (b >= size())
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (auto &loop : bounded_loops)
+    {
+        if (loop.empty() || !inside(loop))
+        {
+            return false;
+        }
+    }
+    return inside(targets) && inside(call_blocks) && inside(leading_calls) && inside(label_blocks);
+}
+
+std::string hashFunction(const llvm::Function &F)
+{
+    // Blocks, arguments and instructions are referred to by their position
+    // in function, anything else is printed as an operand
+    auto local = llvm::DenseMap<const llvm::Value *, unsigned>();
+    unsigned amt_local = 0;
+    for (auto &arg : F.args())
+    {
+        local[&arg] = amt_local++;
+    }
+    for (auto &BB : F)
+    {
+        local[&BB] = amt_local++;
+        for (auto &I : BB)
+        {
+            local[&I] = amt_local++;
+        }
+    }
+
+    std::string buf;
+    llvm::raw_string_ostream out(buf);
+    auto *M = F.getParent();
+    llvm::ModuleSlotTracker slots(M, false);
+
+    auto printOperand = [&](const llvm::Value *V) {
+        auto it = local.find(V);
+        if (it != local.end())
+        {
+            out << " %" << it->second;
+            return;
+        }
+        if (llvm::isa<llvm::MetadataAsValue>(V))
+        {
+            out << " !md";
+            return;
+        }
+        out << " ";
+        V->printAsOperand(out, true, slots);
+
+        // contents of constant globals, e.g. tracepoint names, matter too
+        auto *global = llvm::dyn_cast<llvm::GlobalVariable>(V);
+        auto *expr = llvm::dyn_cast<llvm::ConstantExpr>(V);
+        if (!global && expr && expr->getNumOperands() > 0)
+        {
+            global = llvm::dyn_cast<llvm::GlobalVariable>(expr->getOperand(0));
+        }
+        if (global && global->isConstant() && global->hasDefinitiveInitializer())
+        {
+            out << " = ";
+            global->getInitializer()->printAsOperand(out, true, slots);
+        }
+    };
+
+    // layout and target decide what the pipeline makes of the function
+    out << FormatVersion << " " << LLVM_VERSION_STRING << " " << M->getTargetTriple() << " "
+        << M->getDataLayoutStr() << " " << F.getName() << " ";
+    F.getFunctionType()->print(out);
+    for (auto &BB : F)
+    {
+        out << "\n" << local[&BB] << ":";
+        for (auto &I : BB)
+        {
+            out << "\n  " << I.getOpcodeName() << " " << unsigned(I.getRawSubclassOptionalData()) << " ";
+            I.getType()->print(out);
+
+            if (auto *cmp = llvm::dyn_cast<llvm::CmpInst>(&I))
+            {
+                out << " " << unsigned(cmp->getPredicate());
+            }
+            else if (auto *gep = llvm::dyn_cast<llvm::GetElementPtrInst>(&I))
+            {
+                out << " ";
+                gep->getSourceElementType()->print(out);
+            }
+            else if (auto *alloca = llvm::dyn_cast<llvm::AllocaInst>(&I))
+            {
+                out << " ";
+                alloca->getAllocatedType()->print(out);
+            }
+            else if (auto *phi = llvm::dyn_cast<llvm::PHINode>(&I))
+            {
+                for (auto *incoming : phi->blocks())
+                {
+                    out << " [" << local[incoming] << "]";
+                }
+            }
+            else if (auto *extract = llvm::dyn_cast<llvm::ExtractValueInst>(&I))
+            {
+                for (auto idx : extract->indices())
+                {
+                    out << " ." << idx;
+                }
+            }
+            else if (auto *insert = llvm::dyn_cast<llvm::InsertValueInst>(&I))
+            {
+                for (auto idx : insert->indices())
+                {
+                    out << " ." << idx;
+                }
+            }
+
+            for (auto &op : I.operands())
+            {
+                printOperand(op.get());
+            }
+        }
+    }
+    out.flush();
+
+    llvm::MD5 md5;
+    md5.update(buf);
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    return result.digest().str().str();
+}
+
+AnalysisCache::AnalysisCache(const std::string &dir_)
+    : dir(dir_)
+{
+    llvm::sys::fs::create_directories(dir);
+}
+
+std::string AnalysisCache::path(const std::string &key) const
+{
+    return dir + "/" + key + ".frag";
+}
+
+bool AnalysisCache::load(const std::string &key, FunctionFragment &fragment) const
+{
+    std::ifstream in(path(key), std::ios::binary);
+    return in && fragment.read(in);
+}
+
+void AnalysisCache::store(const std::string &key, const FunctionFragment &fragment) const
+{
+    std::ostringstream data;
+    fragment.write(data);
+
+    // cache is best effort, failed store just leaves the entry missing
+    int fd = -1;
+    llvm::SmallString<128> tmp_path;
+    if (llvm::sys::fs::createUniqueFile(dir + "/" + key + "-%%%%%%.tmp", fd, tmp_path))
+    {
+        return;
+    }
+    {
+        llvm::raw_fd_ostream tmp(fd, true);
+        tmp << data.str();
+        tmp.close();
+        if (tmp.has_error())
+        {
+            tmp.clear_error();
+            llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+    }
+    if (llvm::sys::fs::rename(tmp_path, path(key)))
+    {
+        llvm::sys::fs::remove(tmp_path);
+    }
+}
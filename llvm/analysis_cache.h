@@ -0,0 +1,79 @@
+#pragma once
+
+#include "llvm/IR/Function.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Results of analyses of one function which don't depend on the rest of the
+// module: graph of its blocks, calls, tracepoint labels, costs of
+// instructions and bounded loops.
+// Blocks are numbered from 0 in function order, callees are referenced by
+// name (or by type for indirect calls) and resolved when fragments are
+// joined into a graph.
+struct FunctionFragment
+{
+    // usual edges of block `b' are targets[offsets[b]] ..
+    // targets[offsets[b + 1] - 1]
+    std::vector<Index> offsets = {0};
+    std::vector<Index> targets;
+
+    // calls of every block in order of instructions: block call_blocks[i]
+    // calls function named callees[i], or function of type call_types[i]
+    // through pointer if the name is empty. Intrinsics and inline assembler
+    // aren't listed.
+    std::vector<Index> call_blocks;
+    std::vector<std::string> callees;
+    std::vector<std::string> call_types;
+    // blocks whose first instruction is their first call
+    std::vector<Index> leading_calls;
+
+    // block label_blocks[i] is labeled with tracepoint labels[i], which
+    // follows label_calls[i] calls of the block
+    std::vector<Index> label_blocks;
+    std::vector<TracePoint> labels;
+    std::vector<Index> label_calls;
+
+    // costs of instructions of every block between its events (calls and
+    // labels above in order of instructions): block has one cost more than
+    // events, the first one is cost before the first event, called
+    // instruction is counted after its call and tracepoints are free
+    std::vector<uint64_t> costs;
+
+    std::vector<std::vector<Index>> bounded_loops;
+    // constant upper bound of trip count of every bounded loop
+    std::vector<uint64_t> loop_trip_counts;
+
+    Size size() const { return offsets.size() - 1; }
+
+    // Binary dump, read() returns false on malformed input
+    void write(std::ostream &out) const;
+    bool read(std::istream &in);
+};
+
+// Hex digest of everything in function analyses depend on. Function is
+// hashed structurally rather than printed: printed IR refers to metadata and
+// attribute groups by numbers which depend on the rest of the module.
+std::string hashFunction(const llvm::Function &F);
+
+// Directory of fragments keyed by hashFunction() of function after O1
+// pipeline. Concurrent runs may share directory, since fragments are
+// written to temporary files and renamed.
+class AnalysisCache
+{
+private:
+    std::string dir;
+
+public:
+    AnalysisCache(const std::string &dir_);
+
+    bool load(const std::string &key, FunctionFragment &fragment) const;
+    void store(const std::string &key, const FunctionFragment &fragment) const;
+
+private:
+    std::string path(const std::string &key) const;
+};
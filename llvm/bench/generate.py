@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Synthetic workloads of check_cycles.
+
+Every workload is a textual IR module with tracepoints and a list of
+tracepoint pairs to check. IR is written directly rather than compiled from
+C, so shape and size of the graph don't depend on the front end. Syntax of
+typed pointers is used, which every supported LLVM version reads.
+
+    generate.py <workload> <size> <IR file> <pairs file>
+"""
+
+import sys
+
+
+class Module:
+    def __init__(self):
+        self.strings = []
+        self.functions = []
+        self.blocks = 0
+
+    def tracepoint(self, name):
+        """Call instruction of tracepoint `name'"""
+        index = len(self.strings)
+        self.strings.append(name)
+        size = len(name) + 1
+        return ("call void @besc_tracepoint(i8* getelementptr inbounds "
+                "([%d x i8], [%d x i8]* @.bench.%d, i64 0, i64 0))" % (size, size, index))
+
+    def function(self, header, blocks):
+        """`blocks' are pairs of label and list of instructions"""
+        lines = [header + " {"]
+        self.blocks += len(blocks)
+        for label, instructions in blocks:
+            lines.append(label + ":")
+            lines.extend("  " + instruction for instruction in instructions)
+        lines.append("}")
+        self.functions.append("\n".join(lines))
+
+    def text(self):
+        lines = []
+        for index, name in enumerate(self.strings):
+            lines.append('@.bench.%d = private unnamed_addr constant [%d x i8] c"%s\\00"'
+                         % (index, len(name) + 1, name))
+        lines.append("")
+        lines.append("declare void @besc_tracepoint(i8*)")
+        lines.append("declare i32 @rand()")
+        for function in self.functions:
+            lines.append("")
+            lines.append(function)
+        return "\n".join(lines) + "\n"
+
+
+def branch_on_rand(name, then_label, else_label):
+    """Instructions of branch on rand() == 0, `name' makes values unique"""
+    return ["%%%s.r = call i32 @rand()" % name,
+            "%%%s.c = icmp eq i32 %%%s.r, 0" % (name, name),
+            "br i1 %%%s.c, label %%%s, label %%%s" % (name, then_label, else_label)]
+
+
+def main_function(module, calls):
+    """main() calls `calls' between tracepoints main_1 and main_2"""
+    module.function("define i32 @main()", [
+        ("entry", [module.tracepoint("main_1")] + calls + [module.tracepoint("main_2"), "ret i32 0"]),
+    ])
+
+
+def chain(size):
+    """Deep call chain: every function of chain may call the next one"""
+    module = Module()
+    for k in range(size):
+        then = ["call void @f%d()" % (k + 1)] if k + 1 < size else []
+        module.function("define void @f%d()" % k, [
+            ("entry", [module.tracepoint("f%d_1" % k)] + branch_on_rand("b", "then", "next")),
+            ("then", then + ["br label %next"]),
+            ("next", ["ret void"]),
+        ])
+    main_function(module, ["call void @f0()"])
+    pairs = [("main_1", "main_2"), ("main_1", "f%d_1" % (size - 1)), ("f0_1", "f%d_1" % (size - 1))]
+    return module, pairs
+
+
+def switch(size):
+    """Wide fan-out: switch with a tracepoint per case"""
+    module = Module()
+    cases = " ".join("i32 %d, label %%case%d" % (k, k) for k in range(size))
+    blocks = [("entry", ["%r = call i32 @rand()", "switch i32 %%r, label %%end [ %s ]" % cases])]
+    for k in range(size):
+        blocks.append(("case%d" % k, [module.tracepoint("case_%d" % k), "br label %end"]))
+    blocks.append(("end", ["ret void"]))
+    module.function("define void @sw()", blocks)
+    main_function(module, ["call void @sw()"])
+    pairs = [("main_1", "main_2"), ("main_1", "case_%d" % (size - 1)), ("case_0", "main_2")]
+    return module, pairs
+
+
+def loops(size, depth=3, trips=10):
+    """Many functions with nests of bounded loops"""
+    module = Module()
+    for k in range(size):
+        blocks = [("entry", ["br label %l0"])]
+        # headers of loops, the innermost one holds tracepoint
+        for d in range(depth):
+            outer = "entry" if d == 0 else "l%d" % (d - 1)
+            latch_from = "l%d" % d if d + 1 == depth else "x%d" % (d + 1)
+            body = ["%%i%d = phi i32 [ 0, %%%s ], [ %%n%d, %%%s ]" % (d, outer, d, latch_from)]
+            if d + 1 == depth:
+                body.append(module.tracepoint("loop%d_1" % k))
+                body += ["%%n%d = add nsw i32 %%i%d, 1" % (d, d),
+                         "%%c%d = icmp slt i32 %%n%d, %d" % (d, d, trips),
+                         "br i1 %%c%d, label %%l%d, label %%x%d" % (d, d, d)]
+            else:
+                body.append("br label %%l%d" % (d + 1))
+            blocks.append(("l%d" % d, body))
+        # exits of loops are latches of enclosing ones
+        for d in reversed(range(depth)):
+            if d == 0:
+                blocks.append(("x0", ["ret void"]))
+            else:
+                blocks.append(("x%d" % d, [
+                    "%%n%d = add nsw i32 %%i%d, 1" % (d - 1, d - 1),
+                    "%%c%d = icmp slt i32 %%n%d, %d" % (d - 1, d - 1, trips),
+                    "br i1 %%c%d, label %%l%d, label %%x%d" % (d - 1, d - 1, d - 1),
+                ]))
+        module.function("define void @loop%d()" % k, blocks)
+    main_function(module, ["call void @loop%d()" % k for k in range(size)])
+    pairs = [("main_1", "main_2"), ("main_1", "loop%d_1" % (size - 1))]
+    return module, pairs
+
+
+def recursion(size):
+    """Cycles of mutual recursion of two functions"""
+    module = Module()
+    for k in range(size):
+        for name, other in (("a%d" % k, "b%d" % k), ("b%d" % k, "a%d" % k)):
+            module.function("define void @%s(i32 %%d)" % name, [
+                ("entry", [module.tracepoint(name + "_1"),
+                           "%c = icmp sgt i32 %d, 0",
+                           "br i1 %c, label %then, label %next"]),
+                ("then", ["%m = sub nsw i32 %d, 1", "call void @%s(i32 %%m)" % other, "br label %next"]),
+                ("next", ["ret void"]),
+            ])
+    calls = []
+    for k in range(size):
+        calls += ["%%r%d = call i32 @rand()" % k, "call void @a%d(i32 %%r%d)" % (k, k)]
+    main_function(module, calls)
+    pairs = [("main_1", "main_2"), ("a0_1", "b0_1"), ("main_1", "b%d_1" % (size - 1))]
+    return module, pairs
+
+
+def tracepoints(size):
+    """Thousands of tracepoints in one function, every consecutive pair
+    is checked"""
+    module = Module()
+    blocks = []
+    for k in range(size):
+        label = "entry" if k == 0 else "t%d" % k
+        join = "t%d" % (k + 1) if k + 1 < size else "end"
+        blocks.append((label, [module.tracepoint("tp_%d" % k)] + branch_on_rand("b", "d%d" % k, join)))
+        blocks.append(("d%d" % k, ["br label %%%s" % join]))
+    blocks.append(("end", ["ret void"]))
+    # values of branches are named per block
+    for index, (label, instructions) in enumerate(blocks):
+        blocks[index] = (label, [i.replace("%b.", "%%b%d." % index) for i in instructions])
+    module.function("define void @many()", blocks)
+    main_function(module, ["call void @many()"])
+    pairs = [("main_1", "main_2")] + [("tp_%d" % k, "tp_%d" % (k + 1)) for k in range(size - 1)]
+    return module, pairs
+
+
+WORKLOADS = {
+    "chain": chain,
+    "switch": switch,
+    "loops": loops,
+    "recursion": recursion,
+    "tracepoints": tracepoints,
+}
+
+
+def write(workload, size, ir_path, pairs_path):
+    """Returns the number of blocks of module"""
+    module, pairs = WORKLOADS[workload](size)
+    with open(ir_path, "w") as ir_file:
+        ir_file.write(module.text())
+    with open(pairs_path, "w") as pairs_file:
+        for start, final in pairs:
+            pairs_file.write("%s %s\n" % (start, final))
+    return module.blocks
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 5 or sys.argv[1] not in WORKLOADS:
+        sys.stderr.write("Usage: %s %s <size> <IR file> <pairs file>\n" % (sys.argv[0], "|".join(WORKLOADS)))
+        sys.exit(1)
+    write(sys.argv[1], int(sys.argv[2]), sys.argv[3], sys.argv[4])
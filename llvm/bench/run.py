@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Benchmark of insert_tracepoints and check_cycles on synthetic workloads.
+
+Every workload is generated (see generate.py), instrumented to bitcode by
+insert_tracepoints and checked by check_cycles --batch with its pairs. Each
+tool runs --repeat times, median wall and CPU time of every stage of
+check_cycles (see --stats) and of whole insert_tracepoints are reported
+with the largest peak RSS and throughput in blocks of generated module per
+second of wall time.
+
+    run.py [--bin <dir>] [--out <dir>] [--repeat <N>] [--scale <factor>]
+           [--jobs <N>] [--json <file>] [<workload> ...]
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+# generate.py is imported from the source tree, which is kept clean
+sys.dont_write_bytecode = True
+import generate
+
+# sizes of workloads at scale 1, check_cycles takes up to a second on each
+SIZES = {
+    "chain": 5000,
+    "switch": 5000,
+    "loops": 1000,
+    "recursion": 1000,
+    "tracepoints": 5000,
+}
+
+
+def run(command):
+    """Wall and CPU seconds and peak RSS in kilobytes of `command'"""
+    start = time.perf_counter()
+    process = subprocess.Popen(command, stdout=subprocess.DEVNULL)
+    _, status, usage = os.wait4(process.pid, 0)
+    wall = time.perf_counter() - start
+    # exit code of check_cycles is verdict, only signals are failures
+    if os.WIFSIGNALED(status):
+        sys.exit("%s: killed by signal %d" % (command[0], os.WTERMSIG(status)))
+    return wall, usage.ru_utime + usage.ru_stime, usage.ru_maxrss
+
+
+def bench_workload(args, workload):
+    size = max(1, int(SIZES[workload] * args.scale))
+    ir_path = os.path.join(args.out, workload + ".ll")
+    pairs_path = os.path.join(args.out, workload + ".pairs")
+    bc_path = os.path.join(args.out, workload + ".bc")
+    stats_path = os.path.join(args.out, workload + ".stats.json")
+    blocks = generate.write(workload, size, ir_path, pairs_path)
+
+    insert = [run([os.path.join(args.bin, "insert_tracepoints"), ir_path, bc_path]) for _ in range(args.repeat)]
+
+    check_command = [os.path.join(args.bin, "check_cycles"), "--quiet", "--jobs", str(args.jobs),
+                     "--stats", stats_path, bc_path, "--batch", pairs_path]
+    checks = []
+    stages = {}
+    for _ in range(args.repeat):
+        checks.append(run(check_command))
+        with open(stats_path) as stats_file:
+            stats = json.load(stats_file)
+        for stage in stats["stages"]:
+            stages.setdefault(stage["name"], []).append(stage)
+
+    def summary(runs):
+        wall = statistics.median(r[0] for r in runs)
+        return {
+            "wall_seconds": wall,
+            "cpu_seconds": statistics.median(r[1] for r in runs),
+            "peak_rss_kb": max(r[2] for r in runs),
+            "blocks_per_second": blocks / wall if wall > 0 else None,
+        }
+
+    result = {
+        "workload": workload,
+        "size": size,
+        "blocks": blocks,
+        "insert_tracepoints": summary(insert),
+        "check_cycles": summary(checks),
+        "stages": [],
+    }
+    for name, runs in stages.items():
+        result["stages"].append({
+            "name": name,
+            "wall_seconds": statistics.median(s["wall_seconds"] for s in runs),
+            "cpu_seconds": statistics.median(s["cpu_seconds"] for s in runs),
+            "peak_rss_kb": max(s["peak_rss_kb"] for s in runs),
+            "counters": runs[-1]["counters"],
+        })
+    return result
+
+
+def print_result(result):
+    print("%s: size %d, %d blocks" % (result["workload"], result["size"], result["blocks"]))
+    line = "  %-20s %10.1f ms wall %10.1f ms cpu %8.1f MB"
+    for tool in ("insert_tracepoints", "check_cycles"):
+        total = result[tool]
+        print((line + " %12.0f blocks/s") % (tool, total["wall_seconds"] * 1e3, total["cpu_seconds"] * 1e3,
+                                             total["peak_rss_kb"] / 1024, total["blocks_per_second"] or 0))
+    for stage in result["stages"]:
+        print(line % ("  " + stage["name"], stage["wall_seconds"] * 1e3, stage["cpu_seconds"] * 1e3,
+                      stage["peak_rss_kb"] / 1024))
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark of check_cycles on synthetic workloads")
+    parser.add_argument("workloads", nargs="*", metavar="workload",
+                        help="any of %s, all by default" % ", ".join(SIZES))
+    parser.add_argument("--bin", default="build", help="directory of built tools")
+    parser.add_argument("--out", default="build/bench", help="directory of workloads and stats")
+    parser.add_argument("--repeat", type=int, default=3, help="runs of every tool per workload")
+    parser.add_argument("--scale", type=float, default=1.0, help="factor of sizes of workloads")
+    parser.add_argument("--jobs", type=int, default=1, help="--jobs of check_cycles")
+    parser.add_argument("--json", help="write results to file as JSON")
+    args = parser.parse_args()
+    for workload in args.workloads:
+        if workload not in SIZES:
+            parser.error("unknown workload %s" % workload)
+
+    os.makedirs(args.out, exist_ok=True)
+    results = []
+    for workload in args.workloads or list(SIZES):
+        results.append(bench_workload(args, workload))
+        print_result(results[-1])
+
+    if args.json:
+        with open(args.json, "w") as json_file:
+            json.dump({"repeat": args.repeat, "scale": args.scale, "jobs": args.jobs, "results": results},
+                      json_file, indent=2)
+            json_file.write("\n")
+
+
+if __name__ == "__main__":
+    main()
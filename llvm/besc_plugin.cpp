@@ -0,0 +1,233 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "types.h"
+#include "instrumentation.h"
+#include "module_loader.h"
+#include "result_writer.h"
+#include "trace_searcher.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+// New pass manager plugin, so tracepoints are inserted and checked in the
+// module the compiler has in memory instead of in IR files written between
+// tools:
+//
+//     opt -load-pass-plugin besc_plugin.so -passes='besc-insert-tracepoints<loops>,besc-check<pairs=FILE>'
+//     BESC_CHECK='pairs=FILE' clang -fpass-plugin=besc_plugin.so -O1 ...
+//
+// Parameters of both passes are "<name>[=<value>]" separated by ';':
+// returns, loops, calls and budget=N are options of insert_tracepoints.
+// besc-check checks pairs of file (pairs=FILE) or all pairs (matrix) and
+// appends results with a "# <module>" line to file (results=FILE), "-" is
+// stderr and default. verbose dumps graph before results. Module isn't
+// changed by besc-check.
+//
+// Clang runs the passes at the start of optimization pipeline, which it
+// builds unless optimization is off, parameters are environment variables
+// BESC_INSTRUMENT and BESC_CHECK. A pass runs only if its variable is set,
+// empty value means default parameters.
+
+struct PluginOptions
+{
+    Granularity granularity;
+    string pairs_path;
+    bool matrix = false;
+    string results_path = "-";
+    bool verbose = false;
+};
+
+// false on unknown or malformed parameter
+static bool parseParameters(StringRef text, PluginOptions &options)
+{
+    SmallVector<StringRef, 4> parameters;
+    text.split(parameters, ';', -1, false);
+    for (StringRef parameter : parameters)
+    {
+        auto [name, value] = parameter.split('=');
+        bool has_value = parameter.find('=') != StringRef::npos;
+        bool bad = false;
+        if (name == "returns" && !has_value)
+        {
+            options.granularity.returns = true;
+        }
+        else if (name == "loops" && !has_value)
+        {
+            options.granularity.loops = true;
+        }
+        else if (name == "calls" && !has_value)
+        {
+            options.granularity.calls = true;
+        }
+        else if (name == "budget" && has_value)
+        {
+            bad = value.getAsInteger(10, options.granularity.budget);
+        }
+        else if (name == "pairs" && has_value)
+        {
+            options.pairs_path = value.str();
+        }
+        else if (name == "matrix" && !has_value)
+        {
+            options.matrix = true;
+        }
+        else if (name == "results" && has_value)
+        {
+            options.results_path = value.str();
+        }
+        else if (name == "verbose" && !has_value)
+        {
+            options.verbose = true;
+        }
+        else
+        {
+            bad = true;
+        }
+        if (bad)
+        {
+            errs() << "besc_plugin: bad parameter " << parameter << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// parameters of `name<parameters>', empty for `name'
+static bool parsePassName(StringRef pass_name, StringRef name, PluginOptions &options)
+{
+    if (pass_name == name)
+    {
+        return true;
+    }
+    if (!pass_name.consume_front(name) || !pass_name.consume_front("<") || !pass_name.consume_back(">"))
+    {
+        return false;
+    }
+    return parseParameters(pass_name, options);
+}
+
+struct InsertTracePointsPass : PassInfoMixin<InsertTracePointsPass>
+{
+    PluginOptions options;
+
+    InsertTracePointsPass(PluginOptions options_) : options(options_) {}
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &)
+    {
+        BESCVisitor visitor(M, options.granularity);
+        visitor.visit(M);
+        if (!visitor.index)
+        {
+            return PreservedAnalyses::all();
+        }
+        indexTracePoints(M);
+        return PreservedAnalyses::none();
+    }
+};
+
+struct CheckCyclesPass : PassInfoMixin<CheckCyclesPass>
+{
+    PluginOptions options;
+
+    CheckCyclesPass(PluginOptions options_) : options(options_) {}
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &)
+    {
+        auto pairs = vector<TracePointPair>();
+        if (!options.pairs_path.empty())
+        {
+            ifstream pairs_file(options.pairs_path);
+            if (!pairs_file || !readTracePointPairs(pairs_file, pairs))
+            {
+                report_fatal_error(Twine("besc_plugin: can't read pairs ") + options.pairs_path, false);
+            }
+        }
+        else if (!options.matrix)
+        {
+            return PreservedAnalyses::all();
+        }
+
+        ofstream results_file;
+        if (options.results_path != "-")
+        {
+            results_file.open(options.results_path, ios::app);
+            if (!results_file)
+            {
+                report_fatal_error(Twine("besc_plugin: can't write results ") + options.results_path, false);
+            }
+        }
+        ostream &out = options.results_path == "-" ? cerr : results_file;
+        out << "# " << M.getModuleIdentifier() << "\n";
+
+        // checker simplifies module it's given
+        auto clone = CloneModule(M);
+        ResultWriter writer(out, ResultFormat::Text, options.verbose ? Verbosity::Debug : Verbosity::Normal);
+        if (options.matrix)
+        {
+            auto searcher = TraceSearcher(*clone);
+            writer.graph(searcher.getGraph());
+            writer.matrix(searcher.allPairs());
+        }
+        else
+        {
+            runBatchSearch(*clone, pairs, writer);
+        }
+        writer.finish();
+        return PreservedAnalyses::all();
+    }
+};
+
+// environment variable of parameters of pass run by clang
+static PluginOptions environmentOptions(const char *variable)
+{
+    PluginOptions options;
+    const char *parameters = getenv(variable);
+    if (parameters && !parseParameters(parameters, options))
+    {
+        report_fatal_error(Twine("besc_plugin: bad ") + variable, false);
+    }
+    return options;
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+    return {LLVM_PLUGIN_API_VERSION, "besc", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+                PB.registerPipelineParsingCallback(
+                    [](StringRef name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+                        PluginOptions options;
+                        if (parsePassName(name, "besc-insert-tracepoints", options))
+                        {
+                            MPM.addPass(InsertTracePointsPass(options));
+                            return true;
+                        }
+                        if (parsePassName(name, "besc-check", options))
+                        {
+                            MPM.addPass(CheckCyclesPass(options));
+                            return true;
+                        }
+                        return false;
+                    });
+                PB.registerPipelineStartEPCallback([](ModulePassManager &MPM) {
+                    if (getenv("BESC_INSTRUMENT"))
+                    {
+                        MPM.addPass(InsertTracePointsPass(environmentOptions("BESC_INSTRUMENT")));
+                    }
+                    if (getenv("BESC_CHECK"))
+                    {
+                        MPM.addPass(CheckCyclesPass(environmentOptions("BESC_CHECK")));
+                    }
+                });
+            }};
+}
@@ -21,44 +21,350 @@
 #include <llvm/Analysis/ScalarEvolutionExpressions.h>
 #include <llvm/Analysis/AssumptionCache.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/ErrorHandling.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <string>
+#include <thread>
 
-void runO1OptimizationPass(llvm::Module &module) {
-    auto empty_attr_list = llvm::AttributeList();
-    auto pass_builder = llvm::PassBuilder{};
+#include "bounded_loops.h"
+#include "utils.h"
+
+namespace {
 
-    auto loop_manager = llvm::LoopAnalysisManager{};
-    auto cgscc_manager = llvm::CGSCCAnalysisManager{};
-    auto mod_manager = llvm::ModuleAnalysisManager{};
-    auto fa_manager = llvm::FunctionAnalysisManager{};
+// Analysis and pass managers of O1 function simplification pipeline. Every
+// LLVMContext needs its own ones.
+struct O1Pipeline {
+    llvm::PassBuilder pass_builder;
+    llvm::LoopAnalysisManager loop_manager;
+    llvm::CGSCCAnalysisManager cgscc_manager;
+    llvm::ModuleAnalysisManager mod_manager;
+    llvm::FunctionAnalysisManager fa_manager;
+    llvm::FunctionPassManager fp_manager;
 
-    pass_builder.registerModuleAnalyses(mod_manager);
-    pass_builder.registerCGSCCAnalyses(cgscc_manager);
-    pass_builder.registerFunctionAnalyses(fa_manager);
-    pass_builder.registerLoopAnalyses(loop_manager);
-    pass_builder.crossRegisterProxies(loop_manager, fa_manager, cgscc_manager, mod_manager);
+    O1Pipeline() {
+        pass_builder.registerModuleAnalyses(mod_manager);
+        pass_builder.registerCGSCCAnalyses(cgscc_manager);
+        pass_builder.registerFunctionAnalyses(fa_manager);
+        pass_builder.registerLoopAnalyses(loop_manager);
+        pass_builder.crossRegisterProxies(loop_manager, fa_manager, cgscc_manager, mod_manager);
 
-    auto fp_manager = pass_builder.buildFunctionSimplificationPipeline(
-        llvm::PassBuilder::OptimizationLevel::O1,
-        llvm::PassBuilder::ThinLTOPhase::None,
-        true
-    );
+        fp_manager = pass_builder.buildFunctionSimplificationPipeline(
+            llvm::PassBuilder::OptimizationLevel::O1,
+            llvm::PassBuilder::ThinLTOPhase::None,
+            true
+        );
+    }
+};
+
+// What has to be restored after module went through bitcode partitions
+struct GlobalRecord {
+    std::string name;
+    llvm::GlobalValue::LinkageTypes linkage;
+    llvm::Comdat *comdat;
+    bool unnamed;
+};
 
+}
+
+// Walks functions in module order like the serial pass did: attributes of
+// every function with exact definition are dropped when it's reached, so a
+// function is simplified seeing the same callee attributes in any partition.
+// Pipeline runs only on `selected' functions.
+static void runO1Pipeline(llvm::Module &module, const std::vector<bool> &exact,
+                          const std::vector<bool> &selected, std::vector<double> &seconds) {
+    auto empty_attr_list = llvm::AttributeList();
+    O1Pipeline pipeline;
+
+    unsigned i = 0;
     for (auto &fun : module.getFunctionList()) {
-        if (fun.hasExactDefinition()) {
+        if (exact[i]) {
             fun.setAttributes(empty_attr_list);
-            fp_manager.run(fun, fa_manager);
+            if (selected[i]) {
+                auto start = std::chrono::steady_clock::now();
+                pipeline.fp_manager.run(fun, pipeline.fa_manager);
+                seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
         }
+        i++;
     }
 }
 
-std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Function &fun) {
-    std::vector <std::vector<llvm::BasicBlock * >> blocks_groups;
+// Functions are given to partitions greedily by size, largest first, so the
+// assignment depends only on the module
+static std::vector<unsigned> partitionFunctions(const std::vector<llvm::Function *> &functions,
+                                                const std::vector<bool> &exact, unsigned partitions) {
+    auto order = std::vector<unsigned>();
+    auto size = std::vector<unsigned>(functions.size(), 0);
+    for (unsigned i = 0; i < functions.size(); i++) {
+        if (exact[i]) {
+            size[i] = functions[i]->getInstructionCount();
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return size[a] > size[b]; });
+
+    auto partition = std::vector<unsigned>(functions.size(), 0);
+    auto load = std::vector<unsigned long>(partitions, 0);
+    for (auto i : order) {
+        auto lightest = std::min_element(load.begin(), load.end()) - load.begin();
+        partition[i] = lightest;
+        load[lightest] += size[i] + 1;
+    }
+    return partition;
+}
+
+// Links simplified partitions but the first one together in their own
+// LLVMContext, which ignores diagnostics instead of exiting on errors, so a
+// part which can't be read or linked is found while bodies of the module are
+// still there. Linked module is written to `linked'.
+static bool linkParts(const std::vector<llvm::SmallVector<char, 0>> &parts, const std::string &name,
+                      llvm::SmallVector<char, 0> &linked) {
+    llvm::LLVMContext context;
+    context.setDiagnosticHandlerCallBack([](const llvm::DiagnosticInfo &, void *) {});
+    auto result = std::make_unique<llvm::Module>(name, context);
+    for (unsigned part = 1; part < parts.size(); part++) {
+        auto part_buffer = llvm::MemoryBufferRef(llvm::StringRef(parts[part].data(), parts[part].size()), name);
+        auto part_or_err = llvm::parseBitcodeFile(part_buffer, context);
+        if (!part_or_err) {
+            llvm::consumeError(part_or_err.takeError());
+            return false;
+        }
+        if (llvm::Linker::linkModules(*result, std::move(*part_or_err))) {
+            return false;
+        }
+    }
+    llvm::raw_svector_ostream linked_stream(linked);
+    llvm::WriteBitcodeToFile(*result, linked_stream, true);
+    return true;
+}
+
+// Every partition but the first is simplified in its own LLVMContext on its
+// own thread. The module is written to bitcode with all symbols external
+// and named and without comdats, so that partitions can be linked back by
+// name: a worker reads the module lazily, turns functions of other
+// partitions into declarations and its global variables into
+// available_externally ones (their initializers can still be folded),
+// simplifies its functions and writes them back to bitcode. The first
+// partition is simplified in place meanwhile. Then bodies of other
+// partitions are replaced with linked ones and linkage, names, comdats and
+// order of symbols are restored, so the result doesn't depend on scheduling.
+static bool runO1PipelineParallel(llvm::Module &module, const std::vector<llvm::Function *> &functions,
+                                  const std::vector<bool> &exact, unsigned workers,
+                                  std::vector<double> &seconds) {
+    if (!module.alias_empty() || !module.ifunc_empty()) {
+        return false;
+    }
+    for (auto *fun : functions) {
+        for (auto &block : *fun) {
+            if (block.hasAddressTaken()) {
+                return false;
+            }
+        }
+    }
+
+    auto partition = partitionFunctions(functions, exact, workers);
+
+    auto globals = std::vector<llvm::GlobalVariable *>();
+    for (auto &global : module.globals()) {
+        globals.push_back(&global);
+    }
+
+    auto records = std::vector<GlobalRecord>();
+    auto externalize = [&](llvm::GlobalObject &object) {
+        records.push_back({"", object.getLinkage(), object.getComdat(), !object.hasName()});
+        if (!object.hasName()) {
+            object.setName("__besc.unnamed." + std::to_string(records.size()));
+        }
+        records.back().name = object.getName().str();
+        if (object.hasLocalLinkage()) {
+            object.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        }
+        object.setComdat(nullptr);
+    };
+    for (auto *fun : functions) {
+        externalize(*fun);
+    }
+    for (auto *global : globals) {
+        externalize(*global);
+    }
+
+    auto restore = [&]() {
+        for (unsigned i = 0; i < records.size(); i++) {
+            auto &record = records[i];
+            auto *object = llvm::cast<llvm::GlobalObject>(module.getNamedValue(record.name));
+            object->setLinkage(record.linkage);
+            object->setComdat(record.comdat);
+            if (record.unnamed) {
+                object->setName("");
+            }
+            if (i < functions.size()) {
+                auto &list = module.getFunctionList();
+                list.splice(list.end(), list, llvm::cast<llvm::Function>(object)->getIterator());
+            } else {
+                auto &list = module.getGlobalList();
+                list.splice(list.end(), list, llvm::cast<llvm::GlobalVariable>(object)->getIterator());
+            }
+        }
+    };
+
+    auto bitcode = llvm::SmallVector<char, 0>();
+    llvm::raw_svector_ostream bitcode_stream(bitcode);
+    // use lists are kept, passes may depend on their order
+    llvm::WriteBitcodeToFile(module, bitcode_stream, true);
+    auto buffer = llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), module.getModuleIdentifier());
+
+    auto parts = std::vector<llvm::SmallVector<char, 0>>(workers);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](unsigned part) {
+        llvm::LLVMContext context;
+        auto module_or_err = llvm::getLazyBitcodeModule(buffer, context);
+        if (!module_or_err) {
+            llvm::consumeError(module_or_err.takeError());
+            failed = true;
+            return;
+        }
+        auto &copy = **module_or_err;
+
+        auto selected = std::vector<bool>(functions.size(), false);
+        unsigned i = 0;
+        for (auto &fun : copy) {
+            if (!fun.isDeclaration() && partition[i] != part) {
+                fun.deleteBody();
+            }
+            selected[i] = exact[i] && partition[i] == part;
+            i++;
+        }
+        for (auto global = copy.global_begin(); global != copy.global_end();) {
+            auto &current = *global++;
+            if (current.hasAppendingLinkage()) {
+                current.eraseFromParent();
+            } else if (current.hasInitializer()) {
+                current.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            }
+        }
+        if (auto err = copy.materializeAll()) {
+            llvm::consumeError(std::move(err));
+            failed = true;
+            return;
+        }
+
+        runO1Pipeline(copy, exact, selected, seconds);
+
+        llvm::raw_svector_ostream part_stream(parts[part]);
+        llvm::WriteBitcodeToFile(copy, part_stream, true);
+    };
+
+    auto threads = std::vector<std::thread>();
+    for (unsigned part = 1; part < workers; part++) {
+        threads.emplace_back(worker, part);
+    }
+
+    auto selected = std::vector<bool>(functions.size(), false);
+    for (unsigned i = 0; i < functions.size(); i++) {
+        selected[i] = exact[i] && partition[i] == 0;
+    }
+    runO1Pipeline(module, exact, selected, seconds);
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // parts are linked together and read into context of the module before
+    // anything in it is replaced
+    auto linked = llvm::SmallVector<char, 0>();
+    auto simplified = std::unique_ptr<llvm::Module>();
+    if (!failed && linkParts(parts, module.getModuleIdentifier(), linked)) {
+        auto linked_buffer = llvm::MemoryBufferRef(llvm::StringRef(linked.data(), linked.size()),
+                                                   module.getModuleIdentifier());
+        auto linked_or_err = llvm::parseBitcodeFile(linked_buffer, module.getContext());
+        if (linked_or_err) {
+            simplified = std::move(*linked_or_err);
+        } else {
+            llvm::consumeError(linked_or_err.takeError());
+        }
+    }
+
+    if (!simplified) {
+        // bodies of other partitions are still here, simplify them serially
+        for (unsigned i = 0; i < functions.size(); i++) {
+            selected[i] = exact[i] && partition[i] != 0;
+        }
+        runO1Pipeline(module, exact, selected, seconds);
+        restore();
+        return true;
+    }
+
+    for (unsigned i = 0; i < functions.size(); i++) {
+        if (partition[i] != 0 && !functions[i]->isDeclaration()) {
+            functions[i]->deleteBody();
+        }
+    }
+    // defines exactly the functions whose bodies were deleted and the parts
+    // were linked together above, so linking into the module doesn't fail
+    if (llvm::Linker::linkModules(module, std::move(simplified))) {
+        llvm::report_fatal_error("Can't link simplified functions");
+    }
+    restore();
+    return true;
+}
+
+void runO1OptimizationPass(llvm::Module &module) {
+    runO1OptimizationPass(module, 1);
+}
+
+void runO1OptimizationPass(llvm::Module &module, unsigned workers, std::vector<FunctionTiming> *timings) {
+    auto functions = std::vector<llvm::Function *>();
+    auto exact = std::vector<bool>();
+    unsigned amt_exact = 0;
+    for (auto &fun : module) {
+        functions.push_back(&fun);
+        exact.push_back(fun.hasExactDefinition());
+        amt_exact += exact.back();
+    }
+
+    if (workers > amt_exact) {
+        workers = amt_exact;
+    }
+
+    auto seconds = std::vector<double>(functions.size(), 0);
+    if (workers <= 1 || !runO1PipelineParallel(module, functions, exact, workers, seconds)) {
+        runO1Pipeline(module, exact, exact, seconds);
+    }
+
+    if (timings) {
+        // linked functions replaced the old ones, but the order is the same
+        unsigned i = 0;
+        for (auto &fun : module) {
+            if (exact[i]) {
+                timings->push_back({fun.getName().str(), seconds[i]});
+            }
+            i++;
+        }
+    }
+}
+
+// Bounds of loops of function and groups of blocks of bounded ones. Loop is
+// bounded if ScalarEvolution finds constant upper bound of its trip count,
+// even if exact trip count depends on values of function.
+static std::vector<LoopBound> analyseLoops(llvm::Function &fun,
+                                           std::vector <std::vector<llvm::BasicBlock * >> *blocks_groups,
+                                           std::vector<uint64_t> *trip_counts) {
+    std::vector<LoopBound> bounds;
 
     if (fun.getBasicBlockList().size() == 0) {
-        return blocks_groups;
+        return bounds;
     }
 
     auto dt = llvm::DominatorTree(fun);
@@ -68,51 +374,274 @@ std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm:
     auto tli = llvm::TargetLibraryInfo(tlii);
     auto se = llvm::ScalarEvolution(fun, tli, ac, dt, loop_info);
 
-    std::function<bool(llvm::Loop * )> process_loop = [&](llvm::Loop *loop) {
-        auto backedge_taken = se.getBackedgeTakenCount(loop);
-        auto max_backedge_taken = se.getConstantMaxBackedgeTakenCount(loop);
-        auto trip_multiple = se.getSmallConstantTripMultiple(loop);
+    auto position = llvm::DenseMap<llvm::BasicBlock *, unsigned>();
+    unsigned amt_blocks = 0;
+    for (auto &block : fun) {
+        position[&block] = amt_blocks++;
+    }
 
-        bool has_unbounded_subloop = false;
-        for (auto *subloop : loop->getSubLoops()) {
-            if (!process_loop(subloop)) {
-                has_unbounded_subloop = true;
+    std::function<bool(llvm::Loop *, int)> process_loop = [&](llvm::Loop *loop, int parent) {
+        auto bound = LoopBound();
+        bound.function = fun.getName().str();
+        bound.header = position[loop->getHeader()];
+        bound.header_name = loop->getHeader()->getName().str();
+        bound.depth = loop->getLoopDepth();
+        bound.parent = parent;
+        bound.blocks = loop->getNumBlocks();
+        bound.max_trip_count = 0;
+
+        // trip count is one more than backedge taken count, it's computed
+        // one bit wider so that it doesn't wrap
+        auto *max_backedge_taken = llvm::dyn_cast<llvm::SCEVConstant>(se.getConstantMaxBackedgeTakenCount(loop));
+        if (max_backedge_taken) {
+            auto &count = max_backedge_taken->getAPInt();
+            auto max_trip_count = count.zext(count.getBitWidth() + 1) + 1;
+            if (max_trip_count.getActiveBits() <= 64) {
+                bound.max_trip_count = max_trip_count.getZExtValue();
             }
         }
 
-        if (has_unbounded_subloop) {
-            return false;
+        auto *backedge_taken = se.getBackedgeTakenCount(loop);
+        if (!llvm::isa<llvm::SCEVCouldNotCompute>(backedge_taken)) {
+            auto *trip_count = se.getAddExpr(backedge_taken, se.getOne(backedge_taken->getType()));
+            llvm::raw_string_ostream stream(bound.trip_count);
+            trip_count->print(stream);
+            stream.flush();
         }
 
-        if (backedge_taken->getSCEVType() != llvm::scCouldNotCompute
-            && max_backedge_taken->getSCEVType() != llvm::scCouldNotCompute
-            && trip_multiple > 1)
-        {
-            blocks_groups.push_back(loop->getBlocksVector());
-            return true;
-        }
+        int id = bounds.size();
+        bounds.push_back(bound);
 
-        return false;
+        bool bounded = bound.max_trip_count != 0;
+        for (auto *subloop : loop->getSubLoops()) {
+            if (!process_loop(subloop, id)) {
+                bounded = false;
+            }
+        }
+        bounds[id].bounded = bounded;
 
-//        auto buf = std::string();
-//        llvm::raw_string_ostream stream(buf);
-//        stream << "backedge_taken:";
-//        backedge_taken->print(stream);
-//        stream << " max_backedge_taken:";
-//        max_backedge_taken->print(stream);
-//        stream << " trip_multiple:" << trip_multiple;
-//
-//        auto *md = llvm::MDNode::get(context, llvm::MDString::get(context, stream.str().data()));
-//        loop->getHeader()->getInstList().front().setMetadata("besc.loop.info", md);
+        if (bounded && blocks_groups) {
+            blocks_groups->push_back(loop->getBlocksVector());
+            if (trip_counts) {
+                trip_counts->push_back(bound.max_trip_count);
+            }
+        }
+        return bounded;
     };
 
     for (auto *loop : loop_info) {
-        process_loop(loop);
+        process_loop(loop, -1);
+    }
+
+    return bounds;
+}
+
+std::vector<LoopBound> computeLoopBounds(llvm::Function &fun) {
+    return analyseLoops(fun, nullptr, nullptr);
+}
+
+std::vector<LoopBound> computeLoopBounds(llvm::Module &module) {
+    std::vector<LoopBound> bounds;
+    for (auto &fun : module) {
+        auto fun_bounds = computeLoopBounds(fun);
+        // parents are positions in list of the function
+        for (auto &bound : fun_bounds) {
+            if (bound.parent >= 0) {
+                bound.parent += bounds.size();
+            }
+        }
+        bounds.insert(bounds.end(), fun_bounds.begin(), fun_bounds.end());
+    }
+    return bounds;
+}
+
+static std::string csvField(const std::string &str) {
+    if (str.find_first_of(",\"\n\r") == std::string::npos) {
+        return str;
+    }
+    std::string quoted = "\"";
+    for (char c : str) {
+        quoted += c;
+        if (c == '"') {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void writeLoopBounds(std::ostream &out, const std::vector<LoopBound> &bounds, LoopBoundsFormat format) {
+    if (format == LoopBoundsFormat::Csv) {
+        out << "function,header,header_name,depth,parent,blocks,max_trip_count,trip_count,bounded\n";
+        for (auto &bound : bounds) {
+            out << csvField(bound.function) << "," << bound.header << "," << csvField(bound.header_name) << ","
+                << bound.depth << ",";
+            if (bound.parent >= 0) {
+                out << bound.parent;
+            }
+            out << "," << bound.blocks << ",";
+            if (bound.max_trip_count != 0) {
+                out << bound.max_trip_count;
+            }
+            out << "," << csvField(bound.trip_count) << "," << (bound.bounded ? "true" : "false") << "\n";
+        }
+        return;
+    }
+
+    out << "[";
+    for (unsigned i = 0; i < bounds.size(); i++) {
+        auto &bound = bounds[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "  {\"function\": " << jsonString(bound.function)
+            << ", \"header\": " << bound.header
+            << ", \"header_name\": " << jsonString(bound.header_name)
+            << ", \"depth\": " << bound.depth
+            << ", \"parent\": " << (bound.parent >= 0 ? std::to_string(bound.parent) : "null")
+            << ", \"blocks\": " << bound.blocks
+            << ", \"max_trip_count\": " << (bound.max_trip_count != 0 ? std::to_string(bound.max_trip_count) : "null")
+            << ", \"trip_count\": " << (bound.trip_count.empty() ? "null" : jsonString(bound.trip_count))
+            << ", \"bounded\": " << (bound.bounded ? "true" : "false") << "}";
+    }
+    out << (bounds.empty() ? "]\n" : "\n]\n");
+}
+
+std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Function &fun,
+                                                                         std::vector<uint64_t> *trip_counts) {
+    std::vector <std::vector<llvm::BasicBlock * >> blocks_groups;
+    analyseLoops(fun, &blocks_groups, trip_counts);
+    return blocks_groups;
+}
+
+
+std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Module &module, unsigned workers) {
+    std::vector <std::vector<llvm::BasicBlock * >> blocks_groups;
+
+    auto functions = std::vector<llvm::Function *>();
+    for (auto &fun : module) {
+        functions.push_back(&fun);
     }
 
+    for (auto &fun_groups : extractBlocksGroupedByLoops(module, functions, workers)) {
+        blocks_groups.insert(blocks_groups.end(), fun_groups.begin(), fun_groups.end());
+    }
     return blocks_groups;
 }
 
+std::vector <std::vector <std::vector<llvm::BasicBlock * >>> extractBlocksGroupedByLoops(
+    llvm::Module &module, const std::vector<llvm::Function *> &functions, unsigned workers,
+    std::vector<std::vector<uint64_t>> *trip_counts) {
+    std::vector <std::vector <std::vector<llvm::BasicBlock * >>> blocks_groups(functions.size());
+    auto counts = std::vector<std::vector<uint64_t>>(functions.size());
+
+    if (workers > functions.size()) {
+        workers = functions.size();
+    }
+
+    if (workers <= 1) {
+        for (unsigned i = 0; i < functions.size(); i++) {
+            blocks_groups[i] = extractBlocksGroupedByLoops(*functions[i], &counts[i]);
+        }
+        if (trip_counts) {
+            *trip_counts = counts;
+        }
+        return blocks_groups;
+    }
+
+    // workers find their functions by position in module
+    auto module_position = llvm::DenseMap<llvm::Function *, unsigned>();
+    unsigned amt_functions = 0;
+    for (auto &fun : module) {
+        module_position[&fun] = amt_functions++;
+    }
+    auto function_position = std::vector<unsigned>(functions.size());
+    for (unsigned i = 0; i < functions.size(); i++) {
+        function_position[i] = module_position.lookup(functions[i]);
+    }
+
+    // LLVMContext isn't thread safe (SCEV creates constants, AssumptionCache
+    // registers value handles), so every worker lazily reads its own copy of
+    // the module from bitcode and materializes only functions it analyses.
+    // Groups are returned as positions of blocks in their function.
+    auto bitcode = llvm::SmallVector<char, 0>();
+    llvm::raw_svector_ostream bitcode_stream(bitcode);
+    llvm::WriteBitcodeToFile(module, bitcode_stream);
+    auto buffer = llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()), module.getModuleIdentifier());
+
+    auto positions_groups = std::vector<std::vector<std::vector<unsigned>>>(functions.size());
+    std::atomic<unsigned> next_function(0);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&]() {
+        llvm::LLVMContext context;
+        auto module_or_err = llvm::getLazyBitcodeModule(buffer, context);
+        if (!module_or_err) {
+            llvm::consumeError(module_or_err.takeError());
+            failed = true;
+            return;
+        }
+        auto &copy = **module_or_err;
+
+        auto copy_functions = std::vector<llvm::Function *>();
+        for (auto &fun : copy) {
+            copy_functions.push_back(&fun);
+        }
+
+        for (unsigned i = next_function++; i < functions.size() && !failed; i = next_function++) {
+            auto *fun = copy_functions[function_position[i]];
+            if (auto err = fun->materialize()) {
+                llvm::consumeError(std::move(err));
+                failed = true;
+                return;
+            }
+
+            auto position = llvm::DenseMap<llvm::BasicBlock *, unsigned>();
+            unsigned amt_blocks = 0;
+            for (auto &block : *fun) {
+                position[&block] = amt_blocks++;
+            }
+
+            for (auto &group : extractBlocksGroupedByLoops(*fun, &counts[i])) {
+                auto positions = std::vector<unsigned>();
+                for (auto *block : group) {
+                    positions.push_back(position[block]);
+                }
+                positions_groups[i].push_back(positions);
+            }
+
+            fun->deleteBody();
+        }
+    };
+
+    auto threads = std::vector<std::thread>();
+    for (unsigned i = 0; i < workers; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        return extractBlocksGroupedByLoops(module, functions, 1, trip_counts);
+    }
+
+    for (unsigned i = 0; i < functions.size(); i++) {
+        auto blocks = std::vector<llvm::BasicBlock *>();
+        for (auto &block : *functions[i]) {
+            blocks.push_back(&block);
+        }
+        for (auto &positions : positions_groups[i]) {
+            auto group = std::vector<llvm::BasicBlock *>();
+            for (auto position : positions) {
+                group.push_back(blocks[position]);
+            }
+            blocks_groups[i].push_back(group);
+        }
+    }
+    if (trip_counts) {
+        *trip_counts = counts;
+    }
+
+    return blocks_groups;
+}
 
 // -----------------------
 //      Usage example:
@@ -1,8 +1,72 @@
+#pragma once
+
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Function.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
 #include <vector>
 
+struct FunctionTiming {
+    std::string name;
+    double seconds;
+};
+
 void runO1OptimizationPass(llvm::Module &module);
 
-std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Function &fun);
\ No newline at end of file
+// runO1OptimizationPass on `workers' threads, functions are split between
+// separate LLVMContexts and linked back, the result is the same for any
+// number of workers. Wall time of the pipeline on each simplified function
+// is appended to `timings' in module order.
+void runO1OptimizationPass(llvm::Module &module, unsigned workers, std::vector<FunctionTiming> *timings = nullptr);
+
+// Bound of a loop of simplified function as ScalarEvolution computes it
+struct LoopBound {
+    std::string function;
+    // position of header block in function, name of header if it has one
+    unsigned header;
+    std::string header_name;
+    // 1 for outermost loops
+    unsigned depth;
+    // position of enclosing loop in the list of loops, -1 if there is none
+    int parent;
+    unsigned blocks;
+    // constant upper bound of trip count, 0 if it isn't known
+    uint64_t max_trip_count;
+    // trip count as expression of values of function, empty if it can't be
+    // computed
+    std::string trip_count;
+    // loop and all its subloops have constant upper bounds
+    bool bounded;
+};
+
+// Bounds of all loops of function, every loop precedes its subloops
+std::vector<LoopBound> computeLoopBounds(llvm::Function &fun);
+
+std::vector<LoopBound> computeLoopBounds(llvm::Module &module);
+
+enum class LoopBoundsFormat {
+    Json,
+    Csv,
+};
+
+// JSON array of objects or CSV with a header line, unknown values are null
+// and empty fields respectively
+void writeLoopBounds(std::ostream &out, const std::vector<LoopBound> &bounds, LoopBoundsFormat format);
+
+// groups of blocks of bounded loops, subloops precede their loops. Max trip
+// count of every group is appended to `trip_counts' if it's given.
+std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Function &fun,
+                                                                         std::vector<uint64_t> *trip_counts = nullptr);
+
+// extractBlocksGroupedByLoops over all functions of the module on `workers`
+// threads, groups are in order of functions regardless of scheduling
+std::vector <std::vector<llvm::BasicBlock * >> extractBlocksGroupedByLoops(llvm::Module &module, unsigned workers);
+
+// extractBlocksGroupedByLoops of given functions of the module on `workers'
+// threads, i-th element holds groups of i-th function, as well as i-th
+// element of `trip_counts' holds their max trip counts if it's given
+std::vector <std::vector <std::vector<llvm::BasicBlock * >>> extractBlocksGroupedByLoops(
+    llvm::Module &module, const std::vector<llvm::Function *> &functions, unsigned workers,
+    std::vector<std::vector<uint64_t>> *trip_counts = nullptr);
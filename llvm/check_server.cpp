@@ -0,0 +1,270 @@
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include "check_server.h"
+#include "module_loader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace std;
+
+bool CheckServer::serve(istream &in, ostream &out)
+{
+    string line;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string command, name;
+        if (!(fields >> command) || command[0] == '#')
+        {
+            // empty line or comment
+            continue;
+        }
+        fields >> name;
+
+        if (command == "quit")
+        {
+            out << "ok" << endl;
+            return false;
+        }
+        else if (command == "load")
+        {
+            string path;
+            getline(fields >> ws, path);
+            if (name.empty() || path.empty())
+            {
+                out << "error usage: load <name> <IR file>" << endl;
+                continue;
+            }
+            load(name, path, out);
+        }
+        else if (command == "check")
+        {
+            TracePoint start_tp, final_tp;
+            if (!(fields >> start_tp >> final_tp))
+            {
+                out << "error usage: check <name> <start> <final>" << endl;
+                continue;
+            }
+            if (auto *searcher = find(name, out))
+            {
+                out << "ok " << searcher->search(start_tp, final_tp).to_int() << endl;
+            }
+        }
+        else if (command == "matrix")
+        {
+            if (auto *searcher = find(name, out))
+            {
+                ostringstream matrix;
+                matrix << searcher->allPairs();
+                out << "ok " << searcher->getTracePoints().size() + 1 << "\n" << matrix.str() << flush;
+            }
+        }
+        else if (command == "tracepoints")
+        {
+            if (auto *searcher = find(name, out))
+            {
+                auto tracepoints = searcher->getTracePoints();
+                out << "ok " << tracepoints.size() << "\n";
+                for (auto &tp : tracepoints)
+                {
+                    out << tp << "\n";
+                }
+                out << flush;
+            }
+        }
+        else if (command == "unload")
+        {
+            if (find(name, out))
+            {
+                searchers.erase(name);
+                out << "ok" << endl;
+            }
+        }
+        else
+        {
+            out << "error unknown command " << command << endl;
+        }
+    }
+    return true;
+}
+
+void CheckServer::load(const string &name, const string &path, ostream &out)
+{
+    // module and its context are dropped as soon as searcher is built
+    SMDiagnostic Err;
+    LLVMContext Context;
+    unique_ptr<Module> Mod(loadModule(path, Err, Context));
+    if (!Mod)
+    {
+        out << "error " << path << ": " << Err.getMessage().str() << endl;
+        return;
+    }
+    // any pair may be checked later
+    if (auto E = Mod->materializeAll())
+    {
+        out << "error " << path << ": " << toString(move(E)) << endl;
+        return;
+    }
+
+    auto searcher = make_unique<TraceSearcher>(*Mod, options);
+    auto amtTracePoints = searcher->getTracePoints().size();
+    searchers[name] = move(searcher);
+    out << "ok " << amtTracePoints << endl;
+}
+
+TraceSearcher *CheckServer::find(const string &name, ostream &out)
+{
+    auto it = searchers.find(name);
+    if (it == searchers.end())
+    {
+        out << "error module " << name << " isn't loaded" << endl;
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+// Stream buffer over connected socket
+class SocketBuf : public streambuf
+{
+private:
+    int fd;
+    vector<char> in_buf = vector<char>(4096);
+    vector<char> out_buf = vector<char>(4096);
+
+public:
+    SocketBuf(int fd_) : fd(fd_)
+    {
+        setg(in_buf.data(), in_buf.data(), in_buf.data());
+        setp(out_buf.data(), out_buf.data() + out_buf.size());
+    }
+
+    ~SocketBuf() { sync(); }
+
+protected:
+    int_type underflow() override
+    {
+        ssize_t amt;
+        do
+        {
+            amt = ::recv(fd, in_buf.data(), in_buf.size(), 0);
+        } while (amt < 0 && errno == EINTR);
+        if (amt <= 0)
+        {
+            return traits_type::eof();
+        }
+        setg(in_buf.data(), in_buf.data(), in_buf.data() + amt);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (sync() != 0)
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        // client which has gone away mustn't kill server by SIGPIPE
+        char *data = pbase();
+        while (data < pptr())
+        {
+            ssize_t amt = ::send(fd, data, pptr() - data, MSG_NOSIGNAL);
+            if (amt < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (amt <= 0)
+            {
+                setp(out_buf.data(), out_buf.data() + out_buf.size());
+                return -1;
+            }
+            data += amt;
+        }
+        setp(out_buf.data(), out_buf.data() + out_buf.size());
+        return 0;
+    }
+};
+
+int runServer(SearchOptions options, const string &socket_path)
+{
+    auto server = CheckServer(options);
+
+    if (socket_path.empty())
+    {
+        // answers own stdout, so anything else printed goes to stderr
+        ostream out(cout.rdbuf());
+        auto *saved = cout.rdbuf(cerr.rdbuf());
+        server.serve(cin, out);
+        cout.rdbuf(saved);
+        return 0;
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "Socket path is too long: " << socket_path << "\n";
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(socket_path.c_str());
+    if (listener < 0
+        || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+        || ::listen(listener, 16) < 0)
+    {
+        cerr << "Can't listen on " << socket_path << ": " << strerror(errno) << "\n";
+        if (listener >= 0)
+        {
+            ::close(listener);
+        }
+        return 1;
+    }
+
+    bool go_on = true;
+    while (go_on)
+    {
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            cerr << "Can't accept client: " << strerror(errno) << "\n";
+            break;
+        }
+        {
+            SocketBuf buf(client);
+            istream in(&buf);
+            ostream out(&buf);
+            go_on = server.serve(in, out);
+        }
+        ::close(client);
+    }
+
+    ::close(listener);
+    ::unlink(socket_path.c_str());
+    return go_on ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "trace_searcher.h"
+
+// Keeps searchers of loaded modules resident and answers queries on them,
+// so parsing and analyses of module are paid once per load. Protocol is
+// line based, fields are separated by whitespace:
+//
+//   load <name> <IR file>           ok <amount of tracepoints>
+//   check <name> <start> <final>    ok <code of SearchingState>
+//   matrix <name>                   ok <amount of lines>, then the lines
+//   tracepoints <name>              ok <amount>, then one per line
+//   unload <name>                   ok
+//   quit                            ok
+//
+// Failed command is answered with "error <message>".
+class CheckServer
+{
+private:
+    SearchOptions options;
+    std::map<std::string, std::unique_ptr<TraceSearcher>> searchers;
+
+public:
+    CheckServer(SearchOptions options_) : options(options_) {}
+
+    // Answers commands until end of input or quit, returns false on quit
+    bool serve(std::istream &in, std::ostream &out);
+
+private:
+    void load(const std::string &name, const std::string &path, std::ostream &out);
+    TraceSearcher *find(const std::string &name, std::ostream &out);
+};
+
+// Serves stdin if `socket_path' is empty, otherwise listens on Unix socket
+// and serves its clients one by one until some of them sends quit
+int runServer(SearchOptions options, const std::string &socket_path);
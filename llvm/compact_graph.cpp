@@ -0,0 +1,13 @@
+#include "compact_graph.h"
+
+const Vertex CompactGraph::NoVertex;
+
+Size CompactGraph::amtCalls() const
+{
+    Size amt = 0;
+    for (Vertex to : callee)
+    {
+        amt += to != NoVertex;
+    }
+    return amt;
+}
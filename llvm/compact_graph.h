@@ -0,0 +1,77 @@
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Graph of basic blocks in compressed sparse row form. Vertices are dense
+// ids, usual edges of vertex `v' are targets[offsets[v]] ..
+// targets[offsets[v + 1] - 1] and call edge of `v' (if any) is callee[v].
+//
+// Graph is filled row by row: addVertex() starts a new row and addEdge()
+// appends edge to the last one.
+class CompactGraph
+{
+public:
+    static const Vertex NoVertex = ~0u;
+
+private:
+    std::vector<Index> offsets = {0};
+    std::vector<Vertex> targets;
+    std::vector<Vertex> callee;
+
+public:
+    Size size() const { return callee.size(); }
+
+    Size amtEdges() const { return targets.size(); }
+
+    Size amtCalls() const;
+
+    void reserve(Size amtVertices)
+    {
+        offsets.reserve(amtVertices + 1);
+        callee.reserve(amtVertices);
+    }
+
+    Vertex addVertex()
+    {
+        offsets.push_back(targets.size());
+        callee.push_back(NoVertex);
+        return callee.size() - 1;
+    }
+
+    void addEdge(Vertex to)
+    {
+        targets.push_back(to);
+        offsets.back()++;
+    }
+
+    void setCallee(Vertex v, Vertex to) { callee[v] = to; }
+
+    llvm::ArrayRef<Vertex> successors(Vertex v) const
+    {
+        return llvm::ArrayRef<Vertex>(targets.data() + offsets[v], offsets[v + 1] - offsets[v]);
+    }
+
+    bool hasCall(Vertex v) const { return callee[v] != NoVertex; }
+
+    Vertex getCallee(Vertex v) const { return callee[v]; }
+
+    // Edges of traces: call edge (if any) goes first, then usual edges
+    Size amtTraceEdges(Vertex v) const
+    {
+        return hasCall(v) + offsets[v + 1] - offsets[v];
+    }
+
+    Vertex traceEdge(Vertex v, Index i) const
+    {
+        if (hasCall(v))
+        {
+            return i == 0 ? callee[v] : targets[offsets[v] + i - 1];
+        }
+        return targets[offsets[v] + i];
+    }
+};
@@ -0,0 +1,67 @@
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/MD5.h"
+
+#include "cost_model.h"
+
+#include <sstream>
+
+bool CostModel::read(std::istream &in)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream line_stream(line);
+        std::string opcode;
+        if (!(line_stream >> opcode) || opcode[0] == '#')
+        {
+            continue;
+        }
+        uint64_t cost;
+        std::string rest;
+        if (!(line_stream >> cost) || line_stream >> rest)
+        {
+            std::cerr << "Bad cost: " << line << "\n";
+            return false;
+        }
+        if (opcode == "default")
+        {
+            default_cost = cost;
+        }
+        else
+        {
+            opcode_cost[opcode] = cost;
+        }
+    }
+    return true;
+}
+
+uint64_t CostModel::cost(const llvm::Instruction &I) const
+{
+    if (llvm::isa<llvm::DbgInfoIntrinsic>(I))
+    {
+        return 0;
+    }
+    auto it = opcode_cost.find(I.getOpcodeName());
+    return it != opcode_cost.end() ? it->second : default_cost;
+}
+
+std::string CostModel::fingerprint() const
+{
+    if (opcode_cost.empty() && default_cost == 1)
+    {
+        return "";
+    }
+
+    std::ostringstream table;
+    table << "default " << default_cost << "\n";
+    for (auto &[opcode, cost] : opcode_cost)
+    {
+        table << opcode << " " << cost << "\n";
+    }
+
+    llvm::MD5 md5;
+    md5.update(table.str());
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    return result.digest().str().str();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "llvm/IR/Instruction.h"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+// Cost of execution of instruction for worst-case cost estimation. By
+// default every instruction costs 1, so cost of path is the number of
+// executed instructions. Table assigns costs to opcodes by their names in
+// IR, e.g. "load" or "fdiv", opcodes missing in table cost the default.
+class CostModel
+{
+private:
+    std::map<std::string, uint64_t> opcode_cost;
+    uint64_t default_cost = 1;
+
+public:
+    // Lines "<opcode> <cost>", line "default <cost>" sets cost of the rest
+    // opcodes. Empty lines and lines starting with '#' are skipped,
+    // returns false on malformed line.
+    bool read(std::istream &in);
+
+    // debug info intrinsics are free, they aren't executed
+    uint64_t cost(const llvm::Instruction &I) const;
+
+    // empty for default model, hex digest of table otherwise, so analyses
+    // made with different tables are cached apart
+    std::string fingerprint() const;
+};
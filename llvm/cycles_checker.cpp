@@ -0,0 +1,308 @@
+#include "llvm/ADT/ArrayRef.h"
+
+#include "cycles_checker.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "scc.h"
+
+using namespace llvm;
+using namespace std;
+
+CyclesChecker::CyclesChecker(const CompactGraph& graph_,
+                             vector < vector<Vertex> >& bounded_loops_,
+                             const map<TracePoint, Vertex> &label)
+    : graph(graph_),
+      bounded_loops(graph_.size(), bounded_loops_)
+{
+    color.assign(graph.size(), White);
+    index.assign(graph.size(), 0);
+    lowlink.assign(graph.size(), 0);
+    on_stack.assign(graph.size(), false);
+    skip_branches.assign(graph.size(), false);
+    component_root.assign(graph.size(), 0);
+    status.assign(graph.size(), DfsStatus());
+    summarize(label);
+}
+
+CyclesChecker::DfsStatus CyclesChecker::check(Vertex start_v_, Vertex final_v_)
+{
+    clear();
+    counters = Counters();
+    final_v = final_v_;
+    search(start_v_);
+    return status[start_v_];
+}
+
+void CyclesChecker::clear() {
+    for (Vertex v : visited)
+    {
+        color[v] = White;
+        on_stack[v] = false;
+        skip_branches[v] = false;
+    }
+    visited.clear();
+    scc_stack.clear();
+    dfs_stack.clear();
+}
+
+void CyclesChecker::summarize(const map<TracePoint, Vertex> &label)
+{
+    Size amtTPs = 0;
+    tpAt.assign(graph.size(), NoTracePoint);
+    for (auto &[tp, v] : label)
+    {
+        tpAt[v] = amtTPs++;
+    }
+
+    // statuses of traces which don't reach any final vertex
+    final_v = CompactGraph::NoVertex;
+    for (Vertex v = 0; v < graph.size(); v++)
+    {
+        if (color[v] == White)
+        {
+            search(v);
+        }
+    }
+
+    // tracepoints reachable from components, components are visited in
+    // reverse topological order so reachable ones are completed before
+    auto finder = SCCFinder(graph);
+    vector<Vertex> all_vertices(graph.size());
+    iota(all_vertices.begin(), all_vertices.end(), 0);
+    finder.run(all_vertices);
+    auto &components = finder.getComponents();
+
+    component.assign(graph.size(), 0);
+    vector<BitVector> reached(components.size());
+    for (Index c = 0; c < components.size(); c++)
+    {
+        reached[c] = BitVector(amtTPs);
+        for (Vertex v : components[c])
+        {
+            component[v] = c;
+            if (tpAt[v] != NoTracePoint)
+            {
+                reached[c].set(tpAt[v]);
+            }
+            for (Index i = 0; i < graph.amtTraceEdges(v); i++)
+            {
+                auto to = finder.getComponent(graph.traceEdge(v, i));
+                if (to != c)
+                {
+                    reached[c] |= reached[to];
+                }
+            }
+        }
+    }
+
+    for (Vertex v = 0; v < graph.size(); v++)
+    {
+        if (graph.hasCall(v))
+        {
+            auto to = graph.getCallee(v);
+            summaries.try_emplace(to, Summary{status[to], reached[component[to]]});
+        }
+    }
+    clear();
+}
+
+bool CyclesChecker::useSummary(Vertex v, Vertex to)
+{
+    if (final_v == CompactGraph::NoVertex || tpAt[final_v] == NoTracePoint || component[v] == component[to])
+    {
+        return false;
+    }
+    auto summary = summaries.find(to);
+    if (summary == summaries.end() || summary->second.reached_tps[tpAt[final_v]])
+    {
+        return false;
+    }
+
+    // `to' is never on stack, so it can't be taken for a member of
+    // component being completed
+    color[to] = Black;
+    component_root[to] = to;
+    visited.push_back(to);
+    status[to] = summary->second.status;
+    counters.summaries_used++;
+    return true;
+}
+
+void CyclesChecker::enter(Vertex v)
+{
+    index[v] = lowlink[v] = visited.size();
+    color[v] = Grey;
+    on_stack[v] = true;
+    visited.push_back(v);
+    scc_stack.push_back(v);
+    dfs_stack.push_back({v, 0});
+    counters.visited_vertices++;
+
+    status[v].reached_final_tp = v == final_v;
+    status[v].avoided_final_tp = false;
+    status[v].loop_on_trace_found = false;
+    status[v].real_loop_found = false;
+}
+
+void CyclesChecker::search(Vertex start_v)
+{
+    enter(start_v);
+
+    while (!dfs_stack.empty())
+    {
+        Vertex v = dfs_stack.back().v;
+        Index i = dfs_stack.back().next_edge;
+
+        if (i < amtEdges(v))
+        {
+            Vertex to = edge(v, i);
+            if (color[to] == White && !(i == 0 && hasCall(v) && useSummary(v, to)))
+            {
+                // edge is finished when `to' is finished
+                enter(to);
+                continue;
+            }
+            finishEdge(v, i, to);
+            continue;
+        }
+
+        dfs_stack.pop_back();
+        color[v] = Black;
+        if (lowlink[v] == index[v])
+        {
+            completeComponent(v);
+        }
+
+        if (!dfs_stack.empty())
+        {
+            Frame &parent = dfs_stack.back();
+            finishEdge(parent.v, parent.next_edge, v);
+        }
+    }
+}
+
+void CyclesChecker::finishEdge(Vertex v, Index i, Vertex to)
+{
+    dfs_stack.back().next_edge++;
+    counters.followed_edges++;
+    counters.back_edges += on_stack[to];
+
+    if (on_stack[to] && lowlink[to] < lowlink[v])
+    {
+        lowlink[v] = lowlink[to];
+    }
+
+    // reachability of `final_v' from `to' is already known if `to' is
+    // finished, even if its component isn't completed yet
+    if (color[to] == Black && status[to].reached_final_tp)
+    {
+        status[v].reached_final_tp = true;
+        if (i == 0 && hasCall(v))
+        {
+            // we already found `final_v' in called function and don't need
+            // to do anything after, so branches of `v' aren't visited
+            skip_branches[v] = true;
+        }
+    }
+}
+
+void CyclesChecker::completeComponent(Vertex root)
+{
+    auto first = find(scc_stack.rbegin(), scc_stack.rend(), root).base() - 1;
+    auto component = ArrayRef<Vertex>(&*first, scc_stack.end() - first);
+    counters.components++;
+    for (Vertex v : component)
+    {
+        on_stack[v] = false;
+        component_root[v] = root;
+    }
+
+    // all ends of edges are visited by now, so vertices out of component
+    // belong to completed components
+    auto inComponent = [&](Vertex w) { return component_root[w] == root; };
+
+    DfsStatus result = DfsStatus();
+    bool cyclic = component.size() > 1;
+
+    for (Vertex v : component)
+    {
+        result.reached_final_tp |= status[v].reached_final_tp;
+    }
+
+    for (Vertex v : component)
+    {
+        if (v == final_v)
+        {
+            continue;
+        }
+
+        if (hasCall(v))
+        {
+            auto to = graph.getCallee(v);
+            if (to == v)
+            {
+                cyclic = true;
+            }
+            else if (!inComponent(to))
+            {
+                if (status[to].reached_final_tp)
+                {
+                    // there is `final_v' in "subgraph" of called function,
+                    // so state is taken from it
+                    result.avoided_final_tp |= status[to].avoided_final_tp;
+                    result.loop_on_trace_found |= status[to].loop_on_trace_found;
+                }
+                else
+                {
+                    // if some loop in called function (or in called function
+                    // of called function etc.) is found, it is on trace if
+                    // component reaches `final_v'
+                    result.loop_on_trace_found |= status[to].real_loop_found;
+                }
+                result.real_loop_found |= status[to].real_loop_found;
+            }
+        }
+
+        if (skip_branches[v])
+        {
+            continue;
+        }
+
+        // we can found vertex without any output edges
+        result.avoided_final_tp |= graph.successors(v).empty();
+
+        for (Vertex to : graph.successors(v))
+        {
+            if (to == v)
+            {
+                cyclic = true;
+            }
+            if (inComponent(to))
+            {
+                continue;
+            }
+            // usual edges are brunches from `br' instruction, so we want to
+            // know if there is some brunch with such property
+            result.avoided_final_tp |= status[to].avoided_final_tp;
+            result.real_loop_found |= status[to].real_loop_found;
+            if (status[to].reached_final_tp)
+            {
+                result.loop_on_trace_found |= status[to].loop_on_trace_found;
+            }
+        }
+    }
+
+    if (cyclic && !bounded_loops.isBounded(component))
+    {
+        result.loop_on_trace_found = true;
+        result.real_loop_found = true;
+    }
+
+    for (Vertex v : component)
+    {
+        status[v] = result;
+    }
+    scc_stack.erase(first, scc_stack.end());
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "types.h"
+#include "compact_graph.h"
+#include "utils.h"
+
+// find loops in graph
+//
+// Vertices reachable from start vertex are visited by iterative Tarjan's
+// algorithm, so native stack doesn't mirror depth of the graph. Status is
+// computed for whole strongly connected component when it is completed: all
+// components reachable from it are completed already, and every cycle of the
+// trace lies in a single component, so loop is found once per component
+// instead of walking DFS stack backwards on every back edge.
+//
+// Called functions are summarized once for all queries. Status of trace from
+// entry of called function which doesn't reach final vertex doesn't depend
+// on final vertex, so it is computed beforehand for every entry along with
+// tracepoints reachable from it. Query doesn't descend into called function
+// if final vertex isn't reachable from its entry and the function can't get
+// back to the caller, status of the call edge is taken from summary instead.
+class CyclesChecker
+{
+public:
+    struct DfsStatus
+    {
+        bool reached_final_tp;
+        bool avoided_final_tp;
+        bool loop_on_trace_found;
+        bool real_loop_found;
+    };
+
+    // work of the last check
+    struct Counters
+    {
+        uint64_t visited_vertices = 0;
+        uint64_t followed_edges = 0;
+        // edges to vertices on stack, they close cycles
+        uint64_t back_edges = 0;
+        uint64_t components = 0;
+        uint64_t summaries_used = 0;
+    };
+
+private:
+    enum Color
+    {
+        White,
+        Grey,
+        Black,
+    };
+
+    struct Frame
+    {
+        Vertex v;
+        Index next_edge; // call edge (if any) goes first, then usual edges
+    };
+
+    struct Summary
+    {
+        DfsStatus status;
+        llvm::BitVector reached_tps;
+    };
+
+    enum : Index { NoTracePoint = ~0u };
+
+    const CompactGraph &graph;
+    BoundedLoopIndex bounded_loops;
+
+    // summaries are keyed by entry vertex of function
+    llvm::DenseMap<Vertex, Summary> summaries;
+    std::vector<Index> tpAt;
+    // strongly connected component of vertex in whole graph
+    std::vector<Index> component;
+
+    std::vector<Color> color;
+    std::vector<Index> index;
+    std::vector<Index> lowlink;
+    std::vector<bool> on_stack;
+    std::vector<bool> skip_branches;
+    std::vector<Vertex> component_root;
+    std::vector<DfsStatus> status;
+
+    std::vector<Vertex> visited;
+    std::vector<Vertex> scc_stack;
+    std::vector<Frame> dfs_stack;
+
+    Vertex final_v;
+    Counters counters;
+
+public:
+    CyclesChecker(const CompactGraph& graph_,
+                  std::vector < std::vector<Vertex> >& bounded_loops_,
+                  const std::map<TracePoint, Vertex> &label);
+
+    DfsStatus check(Vertex start_v_, Vertex final_v_);
+
+    // whether branches of `v' were cut off by the last check, because `v'
+    // calls function which reaches final vertex
+    bool skipsBranches(Vertex v) const { return skip_branches[v]; }
+
+    const Counters &getCounters() const { return counters; }
+
+private:
+    // only vertices visited by previous check are reset
+    void clear();
+
+    void summarize(const std::map<TracePoint, Vertex> &label);
+
+    // mark called function entry `to' as finished with status of its
+    // summary if it's applicable to call from `v'
+    bool useSummary(Vertex v, Vertex to);
+
+    bool hasCall(Vertex v)
+    {
+        return v != final_v && graph.hasCall(v);
+    }
+
+    Size amtEdges(Vertex v)
+    {
+        if (v == final_v || skip_branches[v])
+        {
+            return hasCall(v);
+        }
+        return graph.amtTraceEdges(v);
+    }
+
+    Vertex edge(Vertex v, Index i)
+    {
+        return graph.traceEdge(v, i);
+    }
+
+    void enter(Vertex v);
+
+    void search(Vertex start_v);
+
+    void finishEdge(Vertex v, Index i, Vertex to);
+
+    // compute status of component with root `root' from statuses of
+    // components reachable from it
+    void completeComponent(Vertex root);
+};
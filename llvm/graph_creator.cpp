@@ -0,0 +1,90 @@
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+
+#include "graph_creator.h"
+#include "module_loader.h"
+#include "utils.h"
+
+using namespace llvm;
+using namespace std;
+
+typedef string FunName;
+
+GraphCreator::GraphCreator(Function &F, const CostModel &costs_, const vector<TracePoint> &names_)
+    : costs(costs_),
+      names(names_)
+{
+    Index amtBlocks = 0;
+    for (auto &BB : F)
+    {
+        blockIdx[&BB] = amtBlocks++;
+    }
+    fragment.offsets.reserve(amtBlocks + 1);
+    visit(F);
+}
+
+void GraphCreator::visitBasicBlock(BasicBlock& BB_)
+{
+    auto *BB = &BB_;
+    Index b = fragment.size();
+    fragment.offsets.push_back(fragment.offsets.back());
+    assert(b == blockIdx[BB]);
+    Index amtCalls = 0;
+    fragment.costs.push_back(0);
+    for (auto I = BB->begin(); I != BB->end(); I++)
+    {
+        auto *CB = dyn_cast<CallBase>(I);
+        auto *callee = CB ? dyn_cast<Function>(CB->getCalledOperand()->stripPointerCasts()) : nullptr;
+        if (!CB || CB->isInlineAsm() || (callee && callee->isIntrinsic()))
+        {
+            fragment.costs.back() += costs.cost(*I);
+            continue;
+        }
+
+        TracePoint tp;
+        if (callee && getTracePoint(*CB, names, tp))
+        {
+            fragment.label_blocks.push_back(b);
+            fragment.labels.push_back(tp);
+            fragment.label_calls.push_back(amtCalls);
+            fragment.costs.push_back(0);
+            continue;
+        }
+
+        // call edge exists if callee has body, which is known
+        // only when fragments are joined
+        if (amtCalls == 0 && I == BB->begin())
+        {
+            fragment.leading_calls.push_back(b);
+        }
+        fragment.call_blocks.push_back(b);
+        fragment.callees.push_back(callee ? FunName(callee->getName().str()) : FunName());
+        fragment.call_types.push_back(callee ? "" : printType(CB->getFunctionType()));
+        fragment.costs.push_back(costs.cost(*I));
+        amtCalls++;
+    }
+
+    // calls of the block, invoke and callbr included, are made before
+    // control leaves it through terminator
+    auto *terminator = BB->getTerminator();
+    if (isa<ReturnInst>(terminator) || isa<UnreachableInst>(terminator))
+    {
+        // exit of function, there are no return edges
+        return;
+    }
+    // branch, switch, invoke, indirectbr, callbr and exception handling
+    // terminators, a block reached by several cases gets one edge.
+    // Successors are listed from the last one, as `br' lists them, since
+    // search visits edges in this order.
+    SmallPtrSet<BasicBlock *, 4> targets;
+    for (unsigned i = terminator->getNumSuccessors(); i-- > 0;)
+    {
+        BasicBlock *nextBB = terminator->getSuccessor(i);
+        if (targets.insert(nextBB).second)
+        {
+            fragment.targets.push_back(blockIdx[nextBB]);
+            fragment.offsets.back()++;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/Instructions.h"
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "analysis_cache.h"
+#include "cost_model.h"
+
+// create graph of one function, see FunctionFragment
+//
+// Blocks are numbered in function order beforehand, so rows of fragment are
+// filled while visiting blocks in the same order. Blocks aren't split by
+// calls, calls and tracepoints of block are recorded in order instead.
+class GraphCreator : public llvm::InstVisitor<GraphCreator>
+{
+
+private:
+    FunctionFragment fragment;
+    llvm::DenseMap<llvm::BasicBlock *, Index> blockIdx;
+    const CostModel &costs;
+    // names of integer tracepoint ids, see getTracePoint()
+    const std::vector<TracePoint> &names;
+
+public:
+    GraphCreator(llvm::Function &F, const CostModel &costs_, const std::vector<TracePoint> &names_);
+
+    FunctionFragment getFragment() { return fragment; }
+
+    llvm::DenseMap<llvm::BasicBlock *, Index> getBlockIdx() { return blockIdx; }
+
+    void visitBasicBlock(llvm::BasicBlock& BB_);
+};
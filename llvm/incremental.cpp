@@ -0,0 +1,143 @@
+#include "incremental.h"
+
+#include <sstream>
+
+static const std::string Header = "besc-state 1";
+
+void ResultState::write(std::ostream &out) const
+{
+    out << Header << "\n";
+    for (auto &[name, hash] : function_hash)
+    {
+        out << "function\t" << name << "\t" << hash << "\n";
+    }
+    for (auto &[tp, name] : label_function)
+    {
+        out << "label\t" << tp << "\t" << name << "\n";
+    }
+    for (auto &[pair, verdict] : verdicts)
+    {
+        out << "verdict\t" << pair.first << "\t" << pair.second << "\t" << verdict << "\n";
+    }
+}
+
+bool ResultState::read(std::istream &in)
+{
+    std::string line;
+    if (!std::getline(in, line) || line != Header)
+    {
+        return false;
+    }
+
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, '\t'))
+        {
+            fields.push_back(field);
+        }
+
+        if (fields.size() == 3 && fields[0] == "function")
+        {
+            function_hash[fields[1]] = fields[2];
+        }
+        else if (fields.size() == 3 && fields[0] == "label")
+        {
+            label_function[fields[1]] = fields[2];
+        }
+        else if (fields.size() == 4 && fields[0] == "verdict")
+        {
+            std::istringstream verdict_stream(fields[3]);
+            int verdict;
+            if (!(verdict_stream >> verdict))
+            {
+                return false;
+            }
+            verdicts[{fields[1], fields[2]}] = verdict;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+IncrementalPlan::IncrementalPlan(const ResultState &previous_,
+                                 const ResultState &current_,
+                                 const std::map<std::string, std::vector<std::string>> &callees)
+    : previous(previous_),
+      current(current_)
+{
+    for (auto &[name, hash] : current.function_hash)
+    {
+        auto old = previous.function_hash.find(name);
+        if (old == previous.function_hash.end() || old->second != hash)
+        {
+            changed.insert(name);
+        }
+    }
+    for (auto &[name, hash] : previous.function_hash)
+    {
+        if (current.function_hash.find(name) == current.function_hash.end())
+        {
+            changed.insert(name);
+        }
+    }
+
+    // transitive callers of changed functions
+    auto callers = std::map<std::string, std::vector<std::string>>();
+    for (auto &[caller, called] : callees)
+    {
+        for (auto &callee : called)
+        {
+            callers[callee].push_back(caller);
+        }
+    }
+    auto worklist = std::vector<std::string>(changed.begin(), changed.end());
+    affected = changed;
+    while (!worklist.empty())
+    {
+        auto name = worklist.back();
+        worklist.pop_back();
+        for (auto &caller : callers[name])
+        {
+            if (affected.insert(caller).second)
+            {
+                worklist.push_back(caller);
+            }
+        }
+    }
+}
+
+bool IncrementalPlan::isReusable(const TracePointPair &pair) const
+{
+    if (previous.verdicts.find(pair) == previous.verdicts.end())
+    {
+        return false;
+    }
+
+    // function of tracepoint if it is placed in the state
+    auto placed = [](const ResultState &state, const TracePoint &tp, std::string &name) {
+        auto it = state.label_function.find(tp);
+        if (it == state.label_function.end())
+        {
+            return false;
+        }
+        name = it->second;
+        return true;
+    };
+
+    std::string start_fun, old_start_fun, final_fun, old_final_fun;
+    bool start_placed = placed(current, pair.first, start_fun);
+    bool final_placed = placed(current, pair.second, final_fun);
+    if (start_placed != placed(previous, pair.first, old_start_fun) || start_fun != old_start_fun ||
+        final_placed != placed(previous, pair.second, old_final_fun) || final_fun != old_final_fun)
+    {
+        return false;
+    }
+
+    return !(start_placed && affected.count(start_fun)) && !(final_placed && changed.count(final_fun));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+typedef std::pair<TracePoint, TracePoint> TracePointPair;
+
+// What a run knows about module and verdicts, kept between runs of
+// incremental mode. Functions are identified by name.
+struct ResultState
+{
+    // hash of every function of module, see hashFunction()
+    std::map<std::string, std::string> function_hash;
+    // function where tracepoint is placed
+    std::map<TracePoint, std::string> label_function;
+    // SearchingState::to_int() of checked pairs
+    std::map<TracePointPair, int> verdicts;
+
+    // Tab separated text, read() returns false on malformed input
+    void write(std::ostream &out) const;
+    bool read(std::istream &in);
+};
+
+// Decides which verdicts of previous run still hold for current module.
+//
+// Trace from start tracepoint only visits its function and functions called
+// from it transitively, since there are no return edges. So verdict of pair
+// can change only if function of start tracepoint changed or is a
+// transitive caller of changed function, if function of final tracepoint
+// changed (it could be removed or duplicated there) or if any of the two
+// tracepoints moved to another function.
+class IncrementalPlan
+{
+private:
+    const ResultState &previous;
+    const ResultState &current;
+    std::set<std::string> changed;
+    std::set<std::string> affected;
+
+public:
+    // `callees' maps functions of current module to functions they call
+    IncrementalPlan(const ResultState &previous_,
+                    const ResultState &current_,
+                    const std::map<std::string, std::vector<std::string>> &callees);
+
+    bool isReusable(const TracePointPair &pair) const;
+
+    const std::set<std::string> &getChanged() const { return changed; }
+
+    const std::set<std::string> &getAffected() const { return affected; }
+};
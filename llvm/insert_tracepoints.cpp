@@ -1,98 +1,94 @@
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/IR/InstVisitor.h"
-#include "llvm/IR/BasicBlock.h"
-#include "llvm/IR/GlobalVariable.h"
-#include "llvm/IR/DerivedTypes.h"
 
-#include <map>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 
+#include "instrumentation.h"
+#include "module_loader.h"
+
 using namespace llvm;
 using namespace std;
 
-
-struct BESCVisitor : public InstVisitor<BESCVisitor> {
-
-    Module *M;
-    int index = 0;
-    string prefix = ".tp.str.";
-
-    BESCVisitor(Module &M) {
-        this->M = &M;
-    };
-
-    GlobalVariable* initGlobalVariable(LLVMContext& context, const StringRef& func_tp_name) {
-        return new GlobalVariable(
-            *this->M, 
-            ArrayType::get(Type::getInt8Ty(context), func_tp_name.size() + 1), 
-            true, 
-            GlobalValue::PrivateLinkage, 
-            ConstantDataArray::getString(
-                context, 
-                func_tp_name, 
-                true
-            ), 
-            this->prefix + to_string(this->index++)
-        );
-    }
-
-    void visitFunction(Function &F) {
-        if (F.getName().str() != "besc_tracepoint" && !F.empty() && this->M->getGlobalVariable(this->prefix + to_string(this->index), true) == NULL) {
-            Instruction &firstInst = F.getEntryBlock().front();
-            LLVMContext &context = F.getEntryBlock().getContext();
-            Instruction &lastBlockInst = F.getBasicBlockList().back().back();
-
-            string func_name = F.getName().str();
-            string func_entry = func_name + "_entry";
-            string func_exit = func_name + "_exit";
-
-            Value* offset = ConstantInt::get(Type::getInt64Ty(context), 0);
-
-            Type *ret_type = Type::getVoidTy(context);
-            Type *arg_type = Type::getInt8PtrTy(context);
-            FunctionType *func_type = FunctionType::get(ret_type, {arg_type}, false);
-
-            Type* arg_entry_type = ArrayType::get(Type::getInt8Ty(context), func_entry.size() + 1);
-            Type* arg_exit_type = ArrayType::get(Type::getInt8Ty(context), func_exit.size() + 1);
-
-            FunctionCallee besc_tp = this->M->getOrInsertFunction("besc_tracepoint", func_type);
-
-            Value* arg_ptr_entry = ConstantExpr::getInBoundsGetElementPtr(arg_entry_type, this->initGlobalVariable(context, func_entry), {offset, offset});
-            this->M->getOrInsertGlobal(this->prefix + to_string(this->index - 1), arg_entry_type);
-            CallInst::Create(besc_tp, ArrayRef<Value *>({arg_ptr_entry}), Twine(""), &firstInst);
-
-            Value* arg_ptr_exit = ConstantExpr::getInBoundsGetElementPtr(arg_exit_type, this->initGlobalVariable(context, func_exit), {offset, offset});
-            this->M->getOrInsertGlobal(this->prefix + to_string(this->index - 1), arg_exit_type);
-            CallInst::Create(besc_tp, ArrayRef<Value *>({arg_ptr_exit}), Twine(""), &lastBlockInst);
+int main(int argc, char **argv) {
+    string symbols_path;
+    Granularity granularity;
+    bool budget_usage = false;
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--ids" && i + 1 < argc) {
+            symbols_path = argv[++i];
+        } else if (arg == "--returns") {
+            granularity.returns = true;
+        } else if (arg == "--loops") {
+            granularity.loops = true;
+        } else if (arg == "--calls") {
+            granularity.calls = true;
+        } else if (arg == "--budget" && i + 1 < argc) {
+            budget_usage |= StringRef(argv[++i]).getAsInteger(10, granularity.budget) || granularity.budget < 0;
+        } else {
+            args.push_back(arg);
         }
     }
-};
-
-int main(int argc, char **argv) {
-    if (argc < 2 || 3 < argc) {
-        cerr << "Usage: " << argv[0] << " <input IR file> [<output file>]\n";
+    if (budget_usage || args.size() < 1 || 2 < args.size()) {
+        cerr << "Usage: " << argv[0] << " [options] <input IR file> [<output file>]\n";
+        cerr << "Every function gets tracepoints <function>_entry and <function>_exit, the latter\n";
+        cerr << "before terminator of its last block. Where a place has several instances, their\n";
+        cerr << "tracepoints are numbered, e.g. <function>_exit_2.\n";
+        cerr << "Options:\n";
+        cerr << "  --ids <file>     replace names of tracepoints with integer ids, names of ids are\n";
+        cerr << "                   kept in module and written to symbol table file\n";
+        cerr << "  --returns        <function>_exit before every return instead\n";
+        cerr << "  --loops          <function>_loop<N>_header at header and <function>_loop<N>_latch\n";
+        cerr << "                   before back edge of every loop, loops are numbered from outer\n";
+        cerr << "                   to inner ones\n";
+        cerr << "  --calls          <function>_call<N>_<callee> before every call\n";
+        cerr << "  --budget <N>     at most N loop and call tracepoints per function, loops first\n";
         return 1;
     }
+    const string &output = args.back();
 
     SMDiagnostic Err;
     LLVMContext Context;
-    unique_ptr <Module> Mod(parseIRFile(argv[1], Err, Context));
+    unique_ptr <Module> Mod(parseIRFile(args[0], Err, Context));
     if (!Mod) {
         Err.print(argv[0], errs());
         return 1;
     }
 
-    BESCVisitor visitor(*Mod);
+    BESCVisitor visitor(*Mod, granularity);
     visitor.visit(*Mod);
+    if (!symbols_path.empty()) {
+        auto names = assignTracePointIds(*Mod);
+        writeTracePointNames(*Mod, names);
+        ofstream symbols(symbols_path);
+        writeSymbolTable(symbols, names);
+        if (!symbols) {
+            errs() << argv[0] << ": " << symbols_path << ": can't write symbol table\n";
+            return 1;
+        }
+    }
+    indexTracePoints(*Mod);
 
+    // Output is written as bitcode if its name ends with ".bc"
     std::error_code EC;
-    raw_ostream *out = new raw_fd_ostream(argv[argc - 1], EC, sys::fs::OpenFlags());
-    Mod->print(*out, nullptr);
+    raw_fd_ostream out(output, EC, sys::fs::OpenFlags());
+    if (EC) {
+        errs() << argv[0] << ": " << output << ": " << EC.message() << "\n";
+        return 1;
+    }
+    if (sys::path::extension(output) == ".bc") {
+        WriteBitcodeToFile(*Mod, out);
+    } else {
+        Mod->print(out, nullptr);
+    }
 
     return 0;
 }
@@ -0,0 +1,169 @@
+#include "instrumentation.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+#include <map>
+#include <set>
+
+#include "module_loader.h"
+
+using namespace llvm;
+using namespace std;
+
+BESCVisitor::BESCVisitor(Module &M, Granularity granularity) {
+    this->M = &M;
+    this->granularity = granularity;
+}
+
+GlobalVariable* BESCVisitor::initGlobalVariable(LLVMContext& context, const StringRef& func_tp_name) {
+    return new GlobalVariable(
+        *this->M, 
+        ArrayType::get(Type::getInt8Ty(context), func_tp_name.size() + 1), 
+        true, 
+        GlobalValue::PrivateLinkage, 
+        ConstantDataArray::getString(
+            context, 
+            func_tp_name, 
+            true
+        ), 
+        this->prefix + to_string(this->index++)
+    );
+}
+
+void BESCVisitor::insertTracePoint(const string &tp_name, Instruction *before) {
+    LLVMContext &context = this->M->getContext();
+    Value* offset = ConstantInt::get(Type::getInt64Ty(context), 0);
+
+    Type *ret_type = Type::getVoidTy(context);
+    Type *arg_type = Type::getInt8PtrTy(context);
+    FunctionType *func_type = FunctionType::get(ret_type, {arg_type}, false);
+    FunctionCallee besc_tp = this->M->getOrInsertFunction("besc_tracepoint", func_type);
+
+    Type* arg_str_type = ArrayType::get(Type::getInt8Ty(context), tp_name.size() + 1);
+    Value* arg_ptr = ConstantExpr::getInBoundsGetElementPtr(arg_str_type, this->initGlobalVariable(context, tp_name), {offset, offset});
+    this->M->getOrInsertGlobal(this->prefix + to_string(this->index - 1), arg_str_type);
+    CallInst::Create(besc_tp, ArrayRef<Value *>({arg_ptr}), Twine(""), before);
+}
+
+string BESCVisitor::placeName(const string &base, size_t k, size_t amount) {
+    return amount == 1 ? base : base + "_" + to_string(k + 1);
+}
+
+void BESCVisitor::visitFunction(Function &F) {
+    if (F.getName().str() != "besc_tracepoint" && !F.empty() && this->M->getGlobalVariable(this->prefix + to_string(this->index), true) == NULL) {
+        string func_name = F.getName().str();
+
+        // places are found before any tracepoint is inserted
+        vector<pair<string, Instruction *>> places;
+        places.push_back({func_name + "_entry", &F.getEntryBlock().front()});
+
+        if (this->granularity.returns) {
+            vector<Instruction *> returns;
+            for (auto &BB : F) {
+                if (isa<ReturnInst>(BB.getTerminator())) {
+                    returns.push_back(BB.getTerminator());
+                }
+            }
+            for (size_t k = 0; k < returns.size(); k++) {
+                places.push_back({placeName(func_name + "_exit", k, returns.size()), returns[k]});
+            }
+        } else {
+            places.push_back({func_name + "_exit", &F.getBasicBlockList().back().back()});
+        }
+
+        // loops go from outer to inner ones, then calls, until budget is spent
+        vector<pair<string, Instruction *>> extra_places;
+        if (this->granularity.loops) {
+            DominatorTree DT(F);
+            LoopInfo LI(DT);
+            auto loops = LI.getLoopsInPreorder();
+            for (size_t k = 0; k < loops.size(); k++) {
+                string loop_name = func_name + "_loop" + to_string(k + 1);
+                extra_places.push_back({loop_name + "_header", &*loops[k]->getHeader()->getFirstInsertionPt()});
+                SmallVector<BasicBlock *, 4> latches;
+                loops[k]->getLoopLatches(latches);
+                for (size_t j = 0; j < latches.size(); j++) {
+                    extra_places.push_back({placeName(loop_name + "_latch", j, latches.size()), latches[j]->getTerminator()});
+                }
+            }
+        }
+        if (this->granularity.calls) {
+            int k = 0;
+            for (auto &BB : F) {
+                for (auto &I : BB) {
+                    auto *CB = dyn_cast<CallBase>(&I);
+                    TracePoint tp;
+                    if (!CB || isa<IntrinsicInst>(CB) || CB->isInlineAsm() || getTracePoint(*CB, {}, tp)) {
+                        continue;
+                    }
+                    Function *callee = CB->getCalledFunction();
+                    string callee_name = callee ? callee->getName().str() : "indirect";
+                    extra_places.push_back({func_name + "_call" + to_string(++k) + "_" + callee_name, CB});
+                }
+            }
+        }
+        if (this->granularity.budget >= 0 && extra_places.size() > size_t(this->granularity.budget)) {
+            extra_places.resize(this->granularity.budget);
+        }
+        places.insert(places.end(), extra_places.begin(), extra_places.end());
+
+        for (auto &[tp_name, before] : places) {
+            this->insertTracePoint(tp_name, before);
+        }
+    }
+}
+
+vector<TracePoint> assignTracePointIds(Module &M) {
+    auto &context = M.getContext();
+    auto *id_type = Type::getInt32Ty(context);
+    FunctionCallee id_fun = M.getOrInsertFunction("besc_tracepoint_id", Type::getVoidTy(context), id_type);
+
+    // module may be given ids already
+    auto old_names = readTracePointNames(M);
+    auto names = vector<TracePoint>();
+    auto ids = map<TracePoint, unsigned>();
+    auto calls = vector<pair<CallInst *, unsigned>>();
+    for (auto &F : M) {
+        for (auto &BB : F) {
+            for (auto &I : BB) {
+                auto *CI = dyn_cast<CallInst>(&I);
+                TracePoint tp;
+                if (CI && getTracePoint(*CI, old_names, tp)) {
+                    auto it = ids.insert({tp, names.size()});
+                    if (it.second) {
+                        names.push_back(tp);
+                    }
+                    calls.push_back({CI, it.first->second});
+                }
+            }
+        }
+    }
+
+    auto strings = set<GlobalVariable *>();
+    for (auto &[CI, id] : calls) {
+        if (auto *GV = dyn_cast<GlobalVariable>(CI->getArgOperand(0)->stripPointerCasts())) {
+            strings.insert(GV);
+        }
+        auto *call = CallInst::Create(id_fun, {ConstantInt::get(id_type, id)}, "", CI);
+        call->setDebugLoc(CI->getDebugLoc());
+        CI->eraseFromParent();
+    }
+    for (auto *GV : strings) {
+        GV->removeDeadConstantUsers();
+        if (GV->use_empty() && GV->getParent()) {
+            GV->eraseFromParent();
+        }
+    }
+    if (auto *tp_fun = M.getFunction("besc_tracepoint")) {
+        if (tp_fun->use_empty()) {
+            tp_fun->eraseFromParent();
+        }
+    }
+    return names;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Places of tracepoints besides entry of function
+struct Granularity {
+    // before every return instead of before terminator of the last block
+    bool returns = false;
+    // headers and latches of loops
+    bool loops = false;
+    // before every call, tracepoints and intrinsics aside
+    bool calls = false;
+    // loop and call tracepoints per function, no limit if it's negative
+    int budget = -1;
+};
+
+// Inserts besc_tracepoint("<function>_entry") at the start of every
+// function with body and "<function>_exit" before terminator of its last
+// block, or before every return, and tracepoints of loops and calls by
+// granularity. Where a place has several instances, their tracepoints are
+// numbered, e.g. "<function>_exit_2". Loops are numbered from outer to
+// inner ones, "<function>_loop<N>_header" is at header of loop and
+// "<function>_loop<N>_latch" before its back edge, call tracepoint is
+// "<function>_call<N>_<callee>". Module instrumented before is left as is.
+struct BESCVisitor : public llvm::InstVisitor<BESCVisitor> {
+
+    llvm::Module *M;
+    Granularity granularity;
+    int index = 0;
+    std::string prefix = ".tp.str.";
+
+    BESCVisitor(llvm::Module &M, Granularity granularity = Granularity());
+
+    llvm::GlobalVariable* initGlobalVariable(llvm::LLVMContext& context, const llvm::StringRef& func_tp_name);
+
+    void insertTracePoint(const std::string &tp_name, llvm::Instruction *before);
+
+    // "<base>" if there is one place, "<base>_<k>" otherwise
+    static std::string placeName(const std::string &base, size_t k, size_t amount);
+
+    void visitFunction(llvm::Function &F);
+};
+
+// Replaces every tracepoint call with besc_tracepoint_id(<id>), so neither
+// the program nor the checker handles strings of names. Ids are dense and
+// given in order of the first call of every name, names of ids are
+// returned. Strings of names which aren't referenced anymore are removed.
+std::vector<TracePoint> assignTracePointIds(llvm::Module &M);
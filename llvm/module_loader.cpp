@@ -0,0 +1,348 @@
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "module_loader.h"
+
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+static const char *const IndexName = "besc.tracepoints";
+static const char *const NamesName = "besc.tracepoint.names";
+static const char *const TracePointFunName = "besc_tracepoint";
+static const char *const TracePointIdFunName = "besc_tracepoint_id";
+static const char *const SymbolTableHeader = "besc-symbols 1";
+
+unique_ptr<Module> loadModule(const string &path, SMDiagnostic &err, LLVMContext &context)
+{
+    // textual IR is parsed from null terminated buffer, so only bitcode
+    // buffers are always mapped
+    file_magic magic;
+    bool bitcode = !identify_magic(path, magic) && magic == file_magic::bitcode;
+    auto buffer = MemoryBuffer::getFile(path, -1, !bitcode);
+    if (auto EC = buffer.getError())
+    {
+        err = SMDiagnostic(path, SourceMgr::DK_Error, "Could not open input file: " + EC.message());
+        return nullptr;
+    }
+
+    if (!bitcode)
+    {
+        return parseIR((*buffer)->getMemBufferRef(), err, context);
+    }
+
+    auto module = getOwningLazyBitcodeModule(move(*buffer), context);
+    if (!module)
+    {
+        handleAllErrors(module.takeError(), [&](ErrorInfoBase &EIB) {
+            err = SMDiagnostic(path, SourceMgr::DK_Error, EIB.message());
+        });
+        return nullptr;
+    }
+    return move(*module);
+}
+
+bool getTracePoint(const CallBase &CB, const vector<TracePoint> &names, TracePoint &tp)
+{
+    auto *callee = dyn_cast<Function>(CB.getCalledOperand()->stripPointerCasts());
+    if (!callee || CB.arg_size() != 1)
+    {
+        return false;
+    }
+
+    if (callee->getName() == TracePointIdFunName)
+    {
+        auto *id = dyn_cast<ConstantInt>(CB.getArgOperand(0));
+        if (!id)
+        {
+            return false;
+        }
+        auto value = id->getZExtValue();
+        tp = value < names.size() ? names[value] : to_string(value);
+        return true;
+    }
+
+    StringRef name;
+    if (callee->getName() == TracePointFunName && getConstantStringInfo(CB.getArgOperand(0), name))
+    {
+        tp = name.str();
+        return true;
+    }
+    return false;
+}
+
+vector<TracePoint> readTracePointNames(const Module &M)
+{
+    auto names = vector<TracePoint>();
+    if (auto *table = M.getNamedMetadata(NamesName))
+    {
+        for (auto *entry : table->operands())
+        {
+            auto *name = entry->getNumOperands() == 1 ? dyn_cast<MDString>(entry->getOperand(0)) : nullptr;
+            names.push_back(name ? name->getString().str() : to_string(names.size()));
+        }
+    }
+    return names;
+}
+
+void writeTracePointNames(Module &M, const vector<TracePoint> &names)
+{
+    if (auto *old = M.getNamedMetadata(NamesName))
+    {
+        M.eraseNamedMetadata(old);
+    }
+    auto &context = M.getContext();
+    auto *table = M.getOrInsertNamedMetadata(NamesName);
+    for (auto &name : names)
+    {
+        table->addOperand(MDNode::get(context, {MDString::get(context, name)}));
+    }
+}
+
+void writeSymbolTable(ostream &out, const vector<TracePoint> &names)
+{
+    out << SymbolTableHeader << "\n";
+    for (Index id = 0; id < names.size(); id++)
+    {
+        out << id << "\t" << names[id] << "\n";
+    }
+}
+
+bool readSymbolTable(istream &in, vector<TracePoint> &names)
+{
+    string line;
+    if (!getline(in, line) || line != SymbolTableHeader)
+    {
+        return false;
+    }
+    while (getline(in, line))
+    {
+        auto tab = line.find('\t');
+        if (tab == string::npos || line.substr(0, tab) != to_string(names.size()))
+        {
+            return false;
+        }
+        names.push_back(line.substr(tab + 1));
+    }
+    return true;
+}
+
+// Calls `visit(tp, F)' for every tracepoint of materialized function `F'
+template <typename Visitor>
+static void forEachTracePoint(Function &F, const vector<TracePoint> &names, Visitor visit)
+{
+    for (auto &BB : F)
+    {
+        for (auto &I : BB)
+        {
+            auto *CI = dyn_cast<CallInst>(&I);
+            TracePoint tp;
+            if (CI && getTracePoint(*CI, names, tp))
+            {
+                visit(tp, F);
+            }
+        }
+    }
+}
+
+// whether module calls tracepoints at all
+static bool hasTracePoints(const Module &M)
+{
+    return M.getFunction(TracePointFunName) || M.getFunction(TracePointIdFunName);
+}
+
+void indexTracePoints(Module &M)
+{
+    if (auto *old = M.getNamedMetadata(IndexName))
+    {
+        M.eraseNamedMetadata(old);
+    }
+    if (!hasTracePoints(M))
+    {
+        return;
+    }
+
+    auto &context = M.getContext();
+    auto names = readTracePointNames(M);
+    auto entries = vector<MDNode *>();
+    bool unnamed = false;
+    for (auto &F : M)
+    {
+        forEachTracePoint(F, names, [&](const TracePoint &tp, Function &F) {
+            unnamed |= !F.hasName();
+            entries.push_back(MDNode::get(context, {MDString::get(context, tp),
+                                                    MDString::get(context, F.getName())}));
+        });
+    }
+    if (unnamed)
+    {
+        // function can't be found by index, module is left without it and
+        // tracepoints are searched in bodies
+        return;
+    }
+
+    auto *index = M.getOrInsertNamedMetadata(IndexName);
+    for (auto *entry : entries)
+    {
+        index->addOperand(entry);
+    }
+}
+
+// Functions of tracepoints by index if module has a valid one, otherwise
+// module is materialized and tracepoints are searched in bodies
+static Error findTracePoints(Module &M, multimap<TracePoint, Function *> &places)
+{
+    if (auto E = M.materializeMetadata())
+    {
+        return E;
+    }
+    if (auto *index = M.getNamedMetadata(IndexName))
+    {
+        bool valid = true;
+        for (auto *entry : index->operands())
+        {
+            auto *tp = entry->getNumOperands() == 2 ? dyn_cast<MDString>(entry->getOperand(0)) : nullptr;
+            auto *name = entry->getNumOperands() == 2 ? dyn_cast<MDString>(entry->getOperand(1)) : nullptr;
+            valid &= tp && name;
+            if (valid)
+            {
+                if (auto *F = M.getFunction(name->getString()))
+                {
+                    places.insert({tp->getString().str(), F});
+                }
+            }
+        }
+        if (valid)
+        {
+            return Error::success();
+        }
+        places.clear();
+    }
+
+    if (auto E = M.materializeAll())
+    {
+        return E;
+    }
+    if (hasTracePoints(M))
+    {
+        auto names = readTracePointNames(M);
+        for (auto &F : M)
+        {
+            forEachTracePoint(F, names, [&](const TracePoint &tp, Function &F) { places.insert({tp, &F}); });
+        }
+    }
+    return Error::success();
+}
+
+Error materializeSlice(Module &M, const set<TracePoint> &start_tps, const set<TracePoint> &final_tps)
+{
+    auto places = multimap<TracePoint, Function *>();
+    if (auto E = findTracePoints(M, places))
+    {
+        return E;
+    }
+
+    // functions referred to from start functions, through constants and
+    // initializers of globals too, since O1 pipeline may turn a loaded
+    // function pointer into a direct call
+    auto sliced = set<const Function *>();
+    auto seen = set<const Value *>();
+    auto worklist = vector<Function *>();
+    auto refer = [&](Value *V, auto &refer) -> void {
+        if (!isa<Constant>(V) || !seen.insert(V).second)
+        {
+            return;
+        }
+        if (auto *F = dyn_cast<Function>(V))
+        {
+            sliced.insert(F);
+            worklist.push_back(F);
+        }
+        else if (auto *GV = dyn_cast<GlobalVariable>(V))
+        {
+            if (GV->hasInitializer())
+            {
+                refer(GV->getInitializer(), refer);
+            }
+        }
+        else
+        {
+            // operands of constant expressions, aliasees and resolvers
+            for (auto &op : cast<Constant>(V)->operands())
+            {
+                refer(op.get(), refer);
+            }
+        }
+    };
+    for (auto &tp : start_tps)
+    {
+        for (auto it = places.lower_bound(tp); it != places.upper_bound(tp); it++)
+        {
+            refer(it->second, refer);
+        }
+    }
+    while (!worklist.empty())
+    {
+        auto *F = worklist.back();
+        worklist.pop_back();
+        if (auto E = F->materialize())
+        {
+            return E;
+        }
+        if (F->hasPersonalityFn())
+        {
+            refer(F->getPersonalityFn(), refer);
+        }
+        for (auto &BB : *F)
+        {
+            for (auto &I : BB)
+            {
+                // indirect call may go to any function whose address is
+                // taken somewhere in module
+                auto *CB = dyn_cast<CallBase>(&I);
+                if (CB && !CB->isInlineAsm() && !isa<Function>(CB->getCalledOperand()->stripPointerCasts()))
+                {
+                    return M.materializeAll();
+                }
+                for (auto &op : I.operands())
+                {
+                    refer(op.get(), refer);
+                }
+            }
+        }
+    }
+
+    // final tracepoints only have to be placed, what their functions call
+    // isn't visited from start tracepoints
+    for (auto &tp : final_tps)
+    {
+        for (auto it = places.lower_bound(tp); it != places.upper_bound(tp); it++)
+        {
+            if (sliced.insert(it->second).second)
+            {
+                if (auto E = it->second->materialize())
+                {
+                    return E;
+                }
+            }
+        }
+    }
+
+    for (auto &F : M)
+    {
+        if (!sliced.count(&F) && !F.isDeclaration())
+        {
+            F.deleteBody();
+            F.setComdat(nullptr);
+        }
+    }
+    return M.materializeAll();
+}
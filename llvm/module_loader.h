@@ -0,0 +1,54 @@
+#pragma once
+
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Reads textual IR or bitcode from memory mapped file. Bitcode is read
+// lazily: bodies of functions stay in the file until they are materialized,
+// so module must be materialized by materializeSlice() or materializeAll()
+// before it's analysed.
+std::unique_ptr<llvm::Module> loadModule(const std::string &path,
+                                         llvm::SMDiagnostic &err,
+                                         llvm::LLVMContext &context);
+
+// Tracepoint of call besc_tracepoint("<name>") or besc_tracepoint_id(<id>).
+// Integer id is named by `names', see readTracePointNames(), or by its
+// decimal number if it's out of them. False if `CB' isn't such call.
+bool getTracePoint(const llvm::CallBase &CB, const std::vector<TracePoint> &names, TracePoint &tp);
+
+// Names of integer tracepoint ids kept in module by insert_tracepoints --ids,
+// id is index in names
+std::vector<TracePoint> readTracePointNames(const llvm::Module &M);
+void writeTracePointNames(llvm::Module &M, const std::vector<TracePoint> &names);
+
+// Sidecar symbol table of integer tracepoint ids for tools which don't read
+// module, lines "<id>\t<name>" after a header. read returns false on
+// malformed input.
+void writeSymbolTable(std::ostream &out, const std::vector<TracePoint> &names);
+bool readSymbolTable(std::istream &in, std::vector<TracePoint> &names);
+
+// Records function of every tracepoint of module in named metadata, so
+// materializeSlice() finds tracepoints without reading function bodies.
+void indexTracePoints(llvm::Module &M);
+
+// Materializes functions where `start_tps' are placed, functions they
+// refer to transitively and functions where `final_tps' are placed, bodies
+// of the rest functions are dropped, so they are neither optimized nor
+// analysed. Trace from start tracepoint never leaves functions it refers
+// to, so verdicts of the pairs are the same as for whole module. Module
+// without index is materialized entirely before tracepoints are searched
+// in its bodies, as well as module where the functions make indirect calls.
+llvm::Error materializeSlice(llvm::Module &M,
+                             const std::set<TracePoint> &start_tps,
+                             const std::set<TracePoint> &final_tps);
@@ -0,0 +1,186 @@
+#include "result_writer.h"
+
+#include "utils.h"
+
+using namespace std;
+
+static const size_t FlushSize = 1 << 16;
+
+static const char *jsonBool(bool value)
+{
+    return value ? "true" : "false";
+}
+
+ResultWriter::ResultWriter(ostream &out_, ResultFormat format_, Verbosity verbosity_, bool single_)
+    : out(out_),
+      format(format_),
+      verbosity(verbosity_),
+      single(single_)
+{
+    if (!quiet() && format == ResultFormat::Json)
+    {
+        buffer << "{\n";
+    }
+}
+
+void ResultWriter::graph(const CompactGraph &graph)
+{
+    if (quiet() || verbosity < Verbosity::Debug)
+    {
+        return;
+    }
+    if (format == ResultFormat::Text)
+    {
+        printGraph(buffer, graph);
+        flushIfLarge();
+        return;
+    }
+
+    buffer << "  \"graph\": [";
+    for (Vertex v = 0; v < graph.size(); v++)
+    {
+        buffer << (v ? ",\n" : "\n") << "    {\"edges\": [";
+        auto successors = graph.successors(v);
+        for (Index i = 0; i < successors.size(); i++)
+        {
+            buffer << (i ? ", " : "") << successors[i];
+        }
+        buffer << "], \"callee\": ";
+        if (graph.hasCall(v))
+        {
+            buffer << graph.getCallee(v);
+        }
+        else
+        {
+            buffer << "null";
+        }
+        buffer << "}";
+        flushIfLarge();
+    }
+    buffer << (graph.size() ? "\n  " : "") << "],\n";
+}
+
+void ResultWriter::beginResult(const TracePoint &start_tp, const TracePoint &final_tp, SearchingState state)
+{
+    buffer << (amtResults ? ",\n" : "  \"results\": [\n");
+    buffer << "    {\"start\": " << jsonString(start_tp) << ", \"final\": " << jsonString(final_tp)
+           << ", \"state\": " << state.to_int()
+           << ", \"start_found\": " << jsonBool(!state.StartTPNotFound)
+           << ", \"final_found\": " << jsonBool(!state.FinalTPNotFound)
+           << ", \"reachable\": " << jsonBool(!state.StartTPNotFound && !state.FinalTPNotFound && !state.FinalTPUnreachable)
+           << ", \"loop\": " << jsonBool(state.LoopFound)
+           << ", \"avoidable\": " << jsonBool(state.FinalTPAvoidable);
+    amtResults++;
+}
+
+void ResultWriter::result(const TracePoint &start_tp, const TracePoint &final_tp, SearchingState state)
+{
+    if (quiet())
+    {
+        return;
+    }
+    if (format == ResultFormat::Json)
+    {
+        beginResult(start_tp, final_tp, state);
+        buffer << "}";
+    }
+    else if (single)
+    {
+        buffer << state << "\n";
+    }
+    else
+    {
+        buffer << start_tp << " " << final_tp << " " << state.to_int() << "\n";
+    }
+    flushIfLarge();
+}
+
+void ResultWriter::result(const TracePoint &start_tp, const TracePoint &final_tp, const CostEstimate &estimate)
+{
+    if (quiet())
+    {
+        return;
+    }
+    auto cost = printCost(estimate);
+    if (format == ResultFormat::Json)
+    {
+        SearchingState state = estimate.state;
+        bool number = state.to_int() == 0;
+        beginResult(start_tp, final_tp, estimate.state);
+        buffer << ", \"cost\": " << (number ? cost : "null") << "}";
+    }
+    else if (single)
+    {
+        buffer << cost << "\n";
+    }
+    else
+    {
+        buffer << start_tp << " " << final_tp << " " << cost << "\n";
+    }
+    flushIfLarge();
+}
+
+void ResultWriter::matrix(const vector<TracePoint> &tracepoints, const function<SearchingState(Index, Index)> &state)
+{
+    if (quiet())
+    {
+        return;
+    }
+    if (format == ResultFormat::Json)
+    {
+        for (Index start = 0; start < tracepoints.size(); start++)
+        {
+            for (Index final = 0; final < tracepoints.size(); final++)
+            {
+                result(tracepoints[start], tracepoints[final], state(start, final));
+            }
+        }
+        return;
+    }
+
+    for (auto &tp : tracepoints)
+    {
+        buffer << "\t" << tp;
+    }
+    buffer << "\n";
+    for (Index start = 0; start < tracepoints.size(); start++)
+    {
+        buffer << tracepoints[start];
+        for (Index final = 0; final < tracepoints.size(); final++)
+        {
+            buffer << "\t" << state(start, final).to_int();
+        }
+        buffer << "\n";
+        flushIfLarge();
+    }
+}
+
+void ResultWriter::matrix(const TracePointMatrix &matrix)
+{
+    this->matrix(matrix.getTracePoints(), [&](Index start, Index final) { return matrix.get(start, final); });
+}
+
+void ResultWriter::finish()
+{
+    if (quiet())
+    {
+        finished = true;
+        return;
+    }
+    if (format == ResultFormat::Json)
+    {
+        buffer << (amtResults ? "\n  ]\n}\n" : "  \"results\": []\n}\n");
+    }
+    out << buffer.str() << flush;
+    buffer.str("");
+    finished = true;
+}
+
+void ResultWriter::flushIfLarge()
+{
+    if (buffer.tellp() >= static_cast<streamoff>(FlushSize))
+    {
+        out << buffer.str();
+        buffer.str("");
+    }
+}
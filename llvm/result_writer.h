@@ -0,0 +1,77 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "types.h"
+#include "compact_graph.h"
+#include "searching_state.h"
+#include "trace_point_matrix.h"
+#include "wcet.h"
+
+enum class Verbosity
+{
+    // exit code only
+    Quiet,
+    Normal,
+    // graph is dumped before results
+    Debug,
+};
+
+enum class ResultFormat
+{
+    Text,
+    Json,
+};
+
+// Writes results of a run in one format. Output is buffered and written
+// out when it grows large and by finish(), so a run over many pairs doesn't
+// flush stream per pair.
+//
+// Text result of pair is "<start> <final> <state>" line, or detailed state
+// if the run checks a single pair. JSON is an object with "graph" if it's
+// dumped and "results", array of objects of pairs.
+class ResultWriter
+{
+private:
+    std::ostream &out;
+    ResultFormat format;
+    Verbosity verbosity;
+    bool single;
+
+    std::ostringstream buffer;
+    Size amtResults = 0;
+    bool finished = false;
+
+public:
+    ResultWriter(std::ostream &out_, ResultFormat format_, Verbosity verbosity_, bool single_ = false);
+
+    ~ResultWriter() { finish(); }
+
+    void graph(const CompactGraph &graph);
+
+    void result(const TracePoint &start_tp, const TracePoint &final_tp, SearchingState state);
+
+    // cost is null in JSON unless it's a number, see printCost()
+    void result(const TracePoint &start_tp, const TracePoint &final_tp, const CostEstimate &estimate);
+
+    // tab separated table in text, result per pair in JSON. `state(start,
+    // final)' is state of pair of tracepoints by their indices.
+    void matrix(const std::vector<TracePoint> &tracepoints,
+                const std::function<SearchingState(Index, Index)> &state);
+
+    void matrix(const TracePointMatrix &matrix);
+
+    // nothing is written after it
+    void finish();
+
+private:
+    bool quiet() const { return finished || verbosity == Verbosity::Quiet; }
+
+    // separator and common fields of JSON object of pair
+    void beginResult(const TracePoint &start_tp, const TracePoint &final_tp, SearchingState state);
+
+    void flushIfLarge();
+};
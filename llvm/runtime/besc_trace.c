@@ -0,0 +1,350 @@
+#include "besc_trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DEFAULT_PATH "besc.trace"
+#define DEFAULT_RING_SIZE (1u << 16)
+#define DEFAULT_MAX_THREADS 64u
+#define MAX_RING_SIZE (1u << 28)
+#define MAX_THREADS (1u << 16)
+#define MAX_NAMES 4096u
+// mangled names and call tracepoints of insert_tracepoints --calls are long
+#define NAME_SIZE 256u
+#define LINE_SIZE 64u
+
+// Pointers of names of besc_tracepoint() calls to their tracepoints, so a
+// hit of named tracepoint doesn't compare strings. Names are string
+// literals, the same pointer is the same name.
+#define NAME_CACHE_SIZE (2 * MAX_NAMES)
+
+struct name_cache_entry
+{
+    const char *name;
+    uint32_t tracepoint;
+};
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char *file;
+static struct besc_trace_header *header;
+static uint64_t ring_bytes;
+static uint32_t ring_mask;
+static struct name_cache_entry name_cache[NAME_CACHE_SIZE];
+
+static __thread struct besc_trace_ring *thread_ring;
+static __thread int thread_claimed;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CLOCK BESC_TRACE_CLOCK_TSC
+static inline uint64_t ticks(void)
+{
+    return __rdtsc();
+}
+#elif defined(__aarch64__)
+#define CLOCK BESC_TRACE_CLOCK_TSC
+static inline uint64_t ticks(void)
+{
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+}
+#else
+#define CLOCK BESC_TRACE_CLOCK_MONOTONIC
+static inline uint64_t ticks(void)
+{
+    return monotonic_ns();
+}
+#endif
+
+static uint64_t thread_id(void)
+{
+#ifdef __linux__
+    return (uint64_t)syscall(SYS_gettid);
+#else
+    return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+
+static uint64_t round_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint32_t env_size(const char *name, uint32_t value, uint32_t max)
+{
+    const char *text = getenv(name);
+    if (text && *text)
+    {
+        char *end;
+        unsigned long parsed = strtoul(text, &end, 10);
+        if (!*end && parsed > 0)
+        {
+            value = parsed < max ? (uint32_t)parsed : max;
+        }
+    }
+    return value;
+}
+
+// BESC_TRACE_FILE with "%p" replaced by process id
+static int trace_path(char *path, size_t size)
+{
+    const char *pattern = getenv("BESC_TRACE_FILE");
+    if (!pattern || !*pattern)
+    {
+        pattern = DEFAULT_PATH;
+    }
+    size_t length = 0;
+    for (const char *c = pattern; *c; c++)
+    {
+        int written;
+        if (c[0] == '%' && c[1] == 'p')
+        {
+            written = snprintf(path + length, size - length, "%ld", (long)getpid());
+            c++;
+        }
+        else
+        {
+            written = snprintf(path + length, size - length, "%c", *c);
+        }
+        if (written < 0 || (size_t)written >= size - length)
+        {
+            return 0;
+        }
+        length += written;
+    }
+    return 1;
+}
+
+static void finish(void)
+{
+    if (header)
+    {
+        header->end_ticks = ticks();
+        header->end_ns = monotonic_ns();
+    }
+}
+
+// Forked child has the mapping of the parent, it's not traced not to mix
+// its records into rings of the parent.
+static void forked(void)
+{
+    header = NULL;
+    thread_ring = NULL;
+    thread_claimed = 1;
+}
+
+static void init(void)
+{
+    char path[PATH_MAX];
+    if (!trace_path(path, sizeof(path)))
+    {
+        fprintf(stderr, "besc_trace: too long path of trace file\n");
+        return;
+    }
+
+    uint32_t max_threads = env_size("BESC_TRACE_THREADS", DEFAULT_MAX_THREADS, MAX_THREADS);
+    uint32_t ring_size = env_size("BESC_TRACE_RING", DEFAULT_RING_SIZE, MAX_RING_SIZE);
+    while (ring_size & (ring_size - 1))
+    {
+        ring_size += ring_size & -ring_size;
+    }
+    // rings start at lines, so records of neighbour threads don't share them
+    uint64_t rings_offset = round_up(sizeof(struct besc_trace_header), LINE_SIZE);
+    uint64_t bytes = round_up(sizeof(struct besc_trace_ring) + (uint64_t)ring_size * sizeof(struct besc_trace_record),
+                              LINE_SIZE);
+    uint64_t names_offset = rings_offset + bytes * max_threads;
+    uint64_t size = names_offset + (uint64_t)MAX_NAMES * NAME_SIZE;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "besc_trace: can't open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    // file is sparse, pages of rings are allocated as threads fill them
+    void *mapped = MAP_FAILED;
+    if (!ftruncate(fd, (off_t)size))
+    {
+        mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapped == MAP_FAILED)
+    {
+        fprintf(stderr, "besc_trace: can't map %s: %s\n", path, strerror(errno));
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    file = mapped;
+    struct besc_trace_header *h = mapped;
+    h->version = BESC_TRACE_VERSION;
+    h->clock = CLOCK;
+    h->max_threads = max_threads;
+    h->ring_size = ring_size;
+    h->max_names = MAX_NAMES;
+    h->name_size = NAME_SIZE;
+    h->rings_offset = rings_offset;
+    h->names_offset = names_offset;
+    h->process = (uint64_t)getpid();
+    h->start_ticks = ticks();
+    h->start_ns = monotonic_ns();
+    memcpy(h->magic, BESC_TRACE_MAGIC, sizeof(h->magic));
+
+    ring_bytes = bytes;
+    ring_mask = ring_size - 1;
+    __atomic_store_n(&header, h, __ATOMIC_RELEASE);
+    atexit(finish);
+    pthread_atfork(NULL, NULL, forked);
+}
+
+static struct besc_trace_ring *claim_ring(void)
+{
+    pthread_once(&init_once, init);
+    struct besc_trace_header *h = __atomic_load_n(&header, __ATOMIC_ACQUIRE);
+    if (!h)
+    {
+        return NULL;
+    }
+    uint32_t index = __atomic_fetch_add(&h->amt_threads, 1, __ATOMIC_RELAXED);
+    if (index >= h->max_threads)
+    {
+        return NULL;
+    }
+    struct besc_trace_ring *ring = (struct besc_trace_ring *)(file + h->rings_offset + ring_bytes * index);
+    ring->thread = thread_id();
+    return ring;
+}
+
+// ring of calling thread, null if it isn't traced
+static inline struct besc_trace_ring *current_ring(void)
+{
+    struct besc_trace_ring *ring = thread_ring;
+    if (__builtin_expect(!ring && !thread_claimed, 0))
+    {
+        thread_claimed = 1;
+        ring = thread_ring = claim_ring();
+    }
+    return ring;
+}
+
+// Only the owning thread writes to ring, so record is written without
+// atomics and published by the counter.
+static inline void append(struct besc_trace_ring *ring, uint32_t tracepoint)
+{
+    uint64_t k = ring->amt_records;
+    struct besc_trace_record *record = (struct besc_trace_record *)(ring + 1) + (k & ring_mask);
+    record->timestamp = ticks();
+    record->tracepoint = tracepoint;
+    record->reserved = 0;
+    __atomic_store_n(&ring->amt_records, k + 1, __ATOMIC_RELEASE);
+}
+
+static size_t name_hash(const char *name)
+{
+    return (size_t)(((uintptr_t)name >> 2) * 0x9e3779b97f4a7c15ull >> 32) % NAME_CACHE_SIZE;
+}
+
+// Finds name in the names of the file or adds it, names_lock is held. Name
+// which doesn't fit is cut to name_size bytes without terminating zero, so
+// it's found by the stored prefix.
+static uint32_t add_name(const char *name)
+{
+    struct besc_trace_header *h = header;
+    char *names = file + h->names_offset;
+    for (uint32_t i = 0; i < h->amt_names; i++)
+    {
+        if (!strncmp(names + (size_t)i * h->name_size, name, h->name_size))
+        {
+            return BESC_TRACE_NAMED | i;
+        }
+    }
+    if (h->amt_names == h->max_names)
+    {
+        return BESC_TRACE_UNKNOWN;
+    }
+    size_t length = strlen(name);
+    char *slot = names + (size_t)h->amt_names * h->name_size;
+    memcpy(slot, name, length < h->name_size ? length : h->name_size);
+    __atomic_store_n(&h->amt_names, h->amt_names + 1, __ATOMIC_RELEASE);
+    return BESC_TRACE_NAMED | (h->amt_names - 1);
+}
+
+static uint32_t name_tracepoint(const char *name)
+{
+    size_t hash = name_hash(name);
+    for (size_t i = 0; i < NAME_CACHE_SIZE; i++)
+    {
+        struct name_cache_entry *entry = &name_cache[(hash + i) % NAME_CACHE_SIZE];
+        const char *cached = __atomic_load_n(&entry->name, __ATOMIC_ACQUIRE);
+        if (cached == name)
+        {
+            return entry->tracepoint;
+        }
+        if (!cached)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&names_lock);
+    uint32_t tracepoint = add_name(name);
+    for (size_t i = 0; i < NAME_CACHE_SIZE; i++)
+    {
+        struct name_cache_entry *entry = &name_cache[(hash + i) % NAME_CACHE_SIZE];
+        if (entry->name == name)
+        {
+            break;
+        }
+        if (!entry->name)
+        {
+            entry->tracepoint = tracepoint;
+            __atomic_store_n(&entry->name, name, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&names_lock);
+    return tracepoint;
+}
+
+void besc_tracepoint(char *tracepoint_name)
+{
+    struct besc_trace_ring *ring = current_ring();
+    if (ring)
+    {
+        append(ring, name_tracepoint(tracepoint_name));
+    }
+}
+
+void besc_tracepoint_id(unsigned tracepoint_id)
+{
+    struct besc_trace_ring *ring = current_ring();
+    if (ring)
+    {
+        append(ring, tracepoint_id);
+    }
+}
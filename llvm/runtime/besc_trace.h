@@ -0,0 +1,93 @@
+#pragma once
+
+// Runtime recorder of tracepoints. Every thread writes records of hits of
+// tracepoints to its own ring buffer, which keeps the last ring_size
+// records. Rings are memory mapped from dump file, so records reach the
+// file when process exits or crashes without being written by the
+// recorder. Path of the file is environment variable BESC_TRACE_FILE,
+// "besc.trace" by default, "%p" in it is replaced by process id. Sizes are
+// environment variables BESC_TRACE_RING (records per thread, rounded up to
+// a power of two) and BESC_TRACE_THREADS. Tracing is off if the file can't
+// be mapped.
+//
+// Layout of the file, integers are of the byte order of the machine:
+//
+//     header
+//     max_threads rings at rings_offset, each is ring header and
+//         ring_size records
+//     max_names names at names_offset, each is name_size bytes
+//
+// Counters are updated atomically by the recorder. Reader of the file of
+// running process sees every record before amt_records of its ring.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BESC_TRACE_MAGIC "BESCTRC1"
+#define BESC_TRACE_VERSION 1
+
+enum besc_trace_clock
+{
+    // time stamp counter of CPU
+    BESC_TRACE_CLOCK_TSC = 0,
+    // nanoseconds of CLOCK_MONOTONIC
+    BESC_TRACE_CLOCK_MONOTONIC = 1,
+};
+
+// Record of besc_tracepoint("<name>") has this bit in tracepoint and index
+// of name in the names of the file in the rest bits. Record of
+// besc_tracepoint_id(<id>) has the id, see insert_tracepoints --ids.
+#define BESC_TRACE_NAMED 0x80000000u
+// tracepoint of name which didn't fit into the names
+#define BESC_TRACE_UNKNOWN 0xffffffffu
+
+struct besc_trace_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t clock;
+    uint32_t max_threads;
+    uint32_t ring_size;
+    uint32_t max_names;
+    // including terminating zero, longer names are cut to name_size bytes
+    // without it
+    uint32_t name_size;
+    uint64_t rings_offset;
+    uint64_t names_offset;
+    // threads which have hit a tracepoint, records of threads beyond
+    // max_threads are dropped
+    uint32_t amt_threads;
+    uint32_t amt_names;
+    uint64_t process;
+    // clock and CLOCK_MONOTONIC nanoseconds at start and exit of process,
+    // to convert TSC to time. End ones are zero until exit.
+    uint64_t start_ticks;
+    uint64_t start_ns;
+    uint64_t end_ticks;
+    uint64_t end_ns;
+};
+
+struct besc_trace_ring
+{
+    uint64_t thread;
+    // records ever written, record k is at k % ring_size
+    uint64_t amt_records;
+};
+
+struct besc_trace_record
+{
+    uint64_t timestamp;
+    uint32_t tracepoint;
+    uint32_t reserved;
+};
+
+void besc_tracepoint(char *tracepoint_name);
+
+void besc_tracepoint_id(unsigned tracepoint_id);
+
+#ifdef __cplusplus
+}
+#endif
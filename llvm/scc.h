@@ -0,0 +1,176 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "compact_graph.h"
+
+// Finds strongly connected components of graph (call edges included) with
+// iterative Tarjan's algorithm, so native stack doesn't mirror depth of the
+// graph.
+//
+// Finder can be run many times on different parts of the same graph, state
+// is reset only for vertices visited by previous run.
+class SCCFinder
+{
+private:
+    enum : unsigned { Unvisited = ~0u };
+
+    struct Frame
+    {
+        Vertex v;
+        unsigned next_edge;
+    };
+
+    const CompactGraph &graph;
+
+    std::vector<unsigned> index;
+    std::vector<unsigned> lowlink;
+    std::vector<bool> on_stack;
+    std::vector<bool> self_loop;
+    std::vector<unsigned> component;
+
+    std::vector<Vertex> visited;
+    std::vector<Vertex> scc_stack;
+    std::vector<Frame> dfs_stack;
+    std::vector<std::vector<Vertex>> components;
+
+public:
+    SCCFinder(const CompactGraph &graph_)
+        : graph(graph_),
+          index(graph_.size(), Unvisited),
+          lowlink(graph_.size(), 0),
+          on_stack(graph_.size(), false),
+          self_loop(graph_.size(), false),
+          component(graph_.size(), Unvisited) {}
+
+    // Find components of all vertices reachable from `roots' through
+    // vertices accepted by `allowed', only the first `amt_edges(v)' trace
+    // edges of vertex `v' are followed
+    template <class Allowed, class AmtEdges>
+    void run(const std::vector<Vertex> &roots, Allowed allowed, AmtEdges amt_edges)
+    {
+        clear();
+        for (Vertex root : roots)
+        {
+            if (index[root] == Unvisited && allowed(root))
+            {
+                visit(root, allowed, amt_edges);
+            }
+        }
+    }
+
+    template <class Allowed>
+    void run(const std::vector<Vertex> &roots, Allowed allowed)
+    {
+        run(roots, allowed, [this](Vertex v) { return graph.amtTraceEdges(v); });
+    }
+
+    void run(const std::vector<Vertex> &roots)
+    {
+        run(roots, [](Vertex) { return true; });
+    }
+
+    // Components found by the last run in reverse topological order, i.e.
+    // every edge leads to the same or to an earlier component
+    const std::vector<std::vector<Vertex>> &getComponents() const
+    {
+        return components;
+    }
+
+    // Index of component of `v' in getComponents()
+    unsigned getComponent(Vertex v) const
+    {
+        return component[v];
+    }
+
+    // Component has a cycle if it has more than one vertex or a followed
+    // self-loop
+    bool isCyclic(unsigned c) const
+    {
+        auto &members = components[c];
+        return members.size() > 1 || self_loop[members[0]];
+    }
+
+private:
+    void clear()
+    {
+        for (Vertex v : visited)
+        {
+            index[v] = Unvisited;
+            self_loop[v] = false;
+            component[v] = Unvisited;
+        }
+        visited.clear();
+        components.clear();
+    }
+
+    template <class Allowed, class AmtEdges>
+    void visit(Vertex root, Allowed allowed, AmtEdges amt_edges)
+    {
+        unsigned counter = visited.size();
+        enter(root, counter);
+
+        while (!dfs_stack.empty())
+        {
+            auto &frame = dfs_stack.back();
+            Vertex v = frame.v;
+
+            if (frame.next_edge < amt_edges(v))
+            {
+                Vertex to = graph.traceEdge(v, frame.next_edge++);
+                if (!allowed(to))
+                {
+                    continue;
+                }
+                if (to == v)
+                {
+                    self_loop[v] = true;
+                }
+                if (index[to] == Unvisited)
+                {
+                    enter(to, counter);
+                }
+                else if (on_stack[to] && index[to] < lowlink[v])
+                {
+                    lowlink[v] = index[to];
+                }
+                continue;
+            }
+
+            dfs_stack.pop_back();
+            if (!dfs_stack.empty())
+            {
+                Vertex parent = dfs_stack.back().v;
+                if (lowlink[v] < lowlink[parent])
+                {
+                    lowlink[parent] = lowlink[v];
+                }
+            }
+
+            if (lowlink[v] == index[v])
+            {
+                components.push_back({});
+                Vertex w;
+                do
+                {
+                    w = scc_stack.back();
+                    scc_stack.pop_back();
+                    on_stack[w] = false;
+                    component[w] = components.size() - 1;
+                    components.back().push_back(w);
+                } while (w != v);
+            }
+        }
+    }
+
+    void enter(Vertex v, unsigned &counter)
+    {
+        index[v] = lowlink[v] = counter++;
+        on_stack[v] = true;
+        visited.push_back(v);
+        scc_stack.push_back(v);
+        dfs_stack.push_back({v, 0});
+    }
+};
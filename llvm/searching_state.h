@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+
+// status of trace searching
+class SearchingState
+{
+public:
+    bool StartTPNotFound;    // can't find function "{tp_prefix}{start_tp}"
+    bool FinalTPNotFound;    // can't find function "{tp_prefix}{final_tp}"
+    bool FinalTPUnreachable; // there isn't a path from start_tp to final_tp
+    bool LoopFound;          // there is loop in path between start_tp and final_tp
+    bool FinalTPAvoidable;   // there is path from start_tp, but doesn't reach final_tp
+
+    SearchingState() : StartTPNotFound(false),
+                       FinalTPNotFound(false),
+                       FinalTPUnreachable(false),
+                       LoopFound(false),
+                       FinalTPAvoidable(false) {}
+
+    int to_int()
+    {
+        return StartTPNotFound * 16 +
+               FinalTPNotFound * 8 +
+               FinalTPUnreachable * 4 +
+               LoopFound * 2 +
+               FinalTPAvoidable;
+    }
+
+    // inverse of to_int()
+    static SearchingState from_int(int code)
+    {
+        SearchingState state = SearchingState();
+        state.StartTPNotFound = code & 16;
+        state.FinalTPNotFound = code & 8;
+        state.FinalTPUnreachable = code & 4;
+        state.LoopFound = code & 2;
+        state.FinalTPAvoidable = code & 1;
+        return state;
+    }
+};
+
+// TODO: add priority output
+// pretty print of SearchingState
+std::ostream &operator<<(std::ostream &out, const SearchingState state);
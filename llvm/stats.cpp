@@ -0,0 +1,93 @@
+#include "stats.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+static double cpuSeconds(const rusage &usage)
+{
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+void Stats::begin(const std::string &name)
+{
+    end();
+    stages.emplace_back();
+    stages.back().name = name;
+    running = true;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cpu_start = cpuSeconds(usage);
+    wall_start = std::chrono::steady_clock::now();
+}
+
+void Stats::end()
+{
+    if (!running)
+    {
+        return;
+    }
+    running = false;
+
+    auto &stage = stages.back();
+    stage.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    stage.cpu_seconds = cpuSeconds(usage) - cpu_start;
+    // kilobytes on Linux
+    stage.peak_rss_kb = usage.ru_maxrss;
+}
+
+void Stats::count(const std::string &counter, uint64_t amount)
+{
+    if (stages.empty())
+    {
+        return;
+    }
+    auto &counters = stages.back().counters;
+    auto it = std::find_if(counters.begin(), counters.end(),
+                           [&](const std::pair<std::string, uint64_t> &c) { return c.first == counter; });
+    if (it == counters.end())
+    {
+        counters.push_back({counter, amount});
+    }
+    else
+    {
+        it->second += amount;
+    }
+}
+
+void Stats::write(std::ostream &out) const
+{
+    // names of stages and counters are identifiers, they need no escaping
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(6);
+    json << "{\n  \"stages\": [";
+    double wall = 0, cpu = 0;
+    long peak_rss = 0;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        auto &stage = stages[i];
+        json << (i ? ",\n" : "\n");
+        json << "    {\"name\": \"" << stage.name << "\", \"wall_seconds\": " << stage.wall_seconds
+             << ", \"cpu_seconds\": " << stage.cpu_seconds << ", \"peak_rss_kb\": " << stage.peak_rss_kb
+             << ", \"counters\": {";
+        for (size_t j = 0; j < stage.counters.size(); j++)
+        {
+            json << (j ? ", " : "") << "\"" << stage.counters[j].first << "\": " << stage.counters[j].second;
+        }
+        json << "}}";
+        wall += stage.wall_seconds;
+        cpu += stage.cpu_seconds;
+        peak_rss = std::max(peak_rss, stage.peak_rss_kb);
+    }
+    json << (stages.empty() ? "" : "\n  ") << "],\n";
+    json << "  \"wall_seconds\": " << wall << ",\n";
+    json << "  \"cpu_seconds\": " << cpu << ",\n";
+    json << "  \"peak_rss_kb\": " << peak_rss << "\n}\n";
+    out << json.str();
+}
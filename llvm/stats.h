@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Wall and CPU time, peak resident set size and counters of stages of a
+// run. Stages go one after another, CPU time is of all threads of process
+// and peak RSS is the one of process by the end of stage.
+class Stats
+{
+public:
+    struct Stage
+    {
+        std::string name;
+        double wall_seconds = 0;
+        double cpu_seconds = 0;
+        long peak_rss_kb = 0;
+        // in order of first count
+        std::vector<std::pair<std::string, uint64_t>> counters;
+    };
+
+private:
+    std::vector<Stage> stages;
+    bool running = false;
+    std::chrono::steady_clock::time_point wall_start;
+    double cpu_start = 0;
+
+public:
+    // ends the running stage, if any
+    void begin(const std::string &name);
+    void end();
+
+    // adds `amount' to counter of the last stage
+    void count(const std::string &counter, uint64_t amount = 1);
+
+    const std::vector<Stage> &getStages() const { return stages; }
+
+    // JSON object with stages in order and totals of the run
+    void write(std::ostream &out) const;
+};
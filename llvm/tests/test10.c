@@ -0,0 +1,22 @@
+#include "tracing.h"
+
+void spin(void) {
+    besc_tracepoint("spin_1");
+    while (rand());
+}
+
+void once(void) {
+    besc_tracepoint("once_1");
+}
+
+void never(void) {
+    besc_tracepoint("never_1");
+}
+
+int main() {
+    void (*callback)(void) = rand() ? spin : once;
+    besc_tracepoint("main_1");
+    callback();
+    besc_tracepoint("main_2");
+    return 0;
+}
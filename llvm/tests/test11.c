@@ -0,0 +1,19 @@
+#include "tracing.h"
+
+int main() {
+    besc_tracepoint("main_1");
+    switch (rand()) {
+    case 1:
+        besc_tracepoint("case_1");
+        break;
+    case 2:
+        besc_tracepoint("case_2");
+        while (rand());
+        break;
+    case 3:
+        besc_tracepoint("case_3");
+        break;
+    }
+    besc_tracepoint("main_2");
+    return 0;
+}
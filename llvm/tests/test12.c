@@ -0,0 +1,13 @@
+#include "tracing.h"
+
+int main() {
+    int n = rand();
+    besc_tracepoint("main_1");
+    for (int i = 0; i < n; i++) {
+        besc_tracepoint("loop_1");
+    }
+    besc_tracepoint("main_2");
+    while (rand());
+    besc_tracepoint("main_3");
+    return 0;
+}
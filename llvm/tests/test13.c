@@ -0,0 +1,21 @@
+#include "tracing.h"
+
+// name of 307 bytes, longer than names kept by the recorder
+#define DIGITS "0123456789"
+#define LONG_NAME "main_3_" DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS \
+    DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS \
+    DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS DIGITS
+
+int main(int argc, char **argv) {
+    besc_tracepoint("main_1");
+#ifdef ONCE
+    besc_tracepoint("loop_1");
+#else
+    for (int i = 0; i < argc + 2; i++) {
+        besc_tracepoint("loop_1");
+    }
+#endif
+    besc_tracepoint("main_2");
+    besc_tracepoint(LONG_NAME);
+    return 0;
+}
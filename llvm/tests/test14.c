@@ -0,0 +1,14 @@
+#include "tracing.h"
+
+void f() {
+    besc_tracepoint("f_1");
+}
+
+int main() {
+    besc_tracepoint("main_1");
+    while (rand()) {
+        f();
+    }
+    besc_tracepoint("main_2");
+    return 0;
+}
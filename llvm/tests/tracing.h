@@ -1,3 +1,6 @@
 #pragma once
 
 void besc_tracepoint(char* tracepoint_name);
+
+// call which insert_tracepoints --ids puts instead of besc_tracepoint()
+void besc_tracepoint_id(unsigned tracepoint_id);
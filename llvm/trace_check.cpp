@@ -0,0 +1,311 @@
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "types.h"
+#include "module_loader.h"
+#include "trace_reader.h"
+#include "trace_replay.h"
+#include "trace_searcher.h"
+#include "utils.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+// How traces of pair agree with the checker. It follows trace only in
+// function of start tracepoint and functions it calls, so trace which
+// returned from the function is out of its verdict. Trace contradicts it if
+// a tracepoint is missing in module, or if trace can't return while it
+// reaches unreachable final tracepoint or repeats start one more times than
+// bounded loops allow.
+enum class Agreement
+{
+    Ok,
+    // final tracepoint is unreachable without return from the function
+    Left,
+    Contradicts,
+    // name of a tracepoint didn't fit into the trace
+    Unnamed,
+};
+
+static const char *printAgreement(Agreement agreement)
+{
+    switch (agreement)
+    {
+    case Agreement::Ok:
+        return "ok";
+    case Agreement::Left:
+        return "left";
+    case Agreement::Unnamed:
+        return "unnamed";
+    default:
+        return "contradicts";
+    }
+}
+
+// Static verdict and bound of observed pair
+struct CheckedPair
+{
+    SearchingState state;
+    CostEstimate estimate;
+    Agreement agreement;
+};
+
+static string printLatency(uint64_t ticks, double ns_per_tick)
+{
+    ostringstream out;
+    out << fixed << setprecision(ns_per_tick ? 1 : 0) << (ns_per_tick ? ticks * ns_per_tick : double(ticks));
+    return out.str();
+}
+
+static void writeText(ostream &out, const TraceReplay &replay, const vector<CheckedPair> &checked, double ns_per_tick)
+{
+    auto &pairs = replay.getPairs();
+    auto &observed = replay.getObserved();
+    for (Index i = 0; i < pairs.size(); i++)
+    {
+        auto &o = observed[i];
+        SearchingState state = checked[i].state;
+        out << pairs[i].first << " " << pairs[i].second << " " << o.count << " "
+            << (o.count ? printLatency(o.max_ticks, ns_per_tick) : "-") << " "
+            << (o.count ? printLatency(o.total_ticks / o.count, ns_per_tick) : "-") << " "
+            << o.max_iterations << " " << state.to_int() << " " << printCost(checked[i].estimate)
+            << " " << printAgreement(checked[i].agreement) << "\n";
+    }
+}
+
+static void writeJson(ostream &out, const TraceReader &reader, const TraceReplay &replay,
+                      const vector<CheckedPair> &checked, double ns_per_tick)
+{
+    auto &pairs = replay.getPairs();
+    auto &observed = replay.getObserved();
+    auto &header = reader.getHeader();
+    out << "{\n  \"records\": " << replay.amtRecords() << ",\n  \"threads\": " << reader.amtRings()
+        << ",\n  \"dropped_threads\": " << header.amt_threads - reader.amtRings()
+        << ",\n  \"latency_unit\": " << (ns_per_tick ? "\"ns\"" : "\"ticks\"") << ",\n  \"pairs\": [";
+    for (Index i = 0; i < pairs.size(); i++)
+    {
+        auto &o = observed[i];
+        SearchingState state = checked[i].state;
+        SearchingState cost_state = checked[i].estimate.state;
+        out << (i ? ",\n" : "\n") << "    {\"start\": " << jsonString(pairs[i].first)
+            << ", \"final\": " << jsonString(pairs[i].second) << ", \"observed\": " << o.count
+            << ", \"max_latency\": " << (o.count ? printLatency(o.max_ticks, ns_per_tick) : "null")
+            << ", \"mean_latency\": " << (o.count ? printLatency(o.total_ticks / o.count, ns_per_tick) : "null")
+            << ", \"max_iterations\": " << o.max_iterations << ", \"state\": " << state.to_int()
+            << ", \"bound\": " << (cost_state.to_int() == 0 ? to_string(checked[i].estimate.cost) : "null")
+            << ", \"agreement\": \"" << printAgreement(checked[i].agreement) << "\"}";
+    }
+    out << (pairs.empty() ? "" : "\n  ") << "]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    // Options may be given anywhere, the rest arguments are positional
+    SearchOptions options;
+    string symbols_path;
+    bool json = false;
+    bool format_usage = false;
+    bool jobs_usage = false;
+    vector<string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc)
+        {
+            jobs_usage |= StringRef(argv[++i]).getAsInteger(10, options.workers);
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            options.cache_dir = argv[++i];
+        }
+        else if (arg == "--symbols" && i + 1 < argc)
+        {
+            symbols_path = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            string name = argv[++i];
+            json = name == "json";
+            format_usage |= name != "json" && name != "text";
+        }
+        else if (arg == "--costs" && i + 1 < argc)
+        {
+            ifstream costs_file(argv[++i]);
+            if (!costs_file)
+            {
+                cerr << "Can't open " << argv[i] << "\n";
+                return 1;
+            }
+            if (!options.costs.read(costs_file))
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    bool batch = args.size() >= 3 && args[2] == "--batch";
+    if (format_usage || jobs_usage || (batch ? args.size() > 4 : args.size() != 2 && args.size() != 4))
+    {
+        cerr << "Usage: " << argv[0] << " [options] <IR file> <trace file> [<Start tracepoint> <Final tracepoint>]\n";
+        cerr << "       " << argv[0] << " [options] <IR file> <trace file> --batch [<file with tracepoint pairs>]\n";
+        cerr << "Replays trace recorded by runtime/besc_trace.c from the program built of IR file\n";
+        cerr << "and compares traces between tracepoints with verdicts and worst-case costs of\n";
+        cerr << "check_cycles. Without pairs, every two consecutive tracepoints of a thread are\n";
+        cerr << "checked. Line of pair is \"<start> <final> <traces> <max latency> <mean latency>\n";
+        cerr << "<max iterations> <state> <cost> ok|left|contradicts|unnamed\", latency is in\n";
+        cerr << "nanoseconds or in ticks if the traced process hasn't exited. check_cycles follows\n";
+        cerr << "trace only in function of start tracepoint and functions it calls, trace which\n";
+        cerr << "returned from it is left. Trace contradicts verdict if a tracepoint isn't found\n";
+        cerr << "in module, or if trace can't return from the function and reaches unreachable\n";
+        cerr << "final tracepoint or repeats start one more times than bounded loops allow, exit\n";
+        cerr << "code is 2 then.\n";
+        cerr << "Pair is unnamed if a tracepoint name didn't fit into trace and no given pair has\n";
+        cerr << "the only name it begins with.\n";
+        cerr << "Options:\n";
+        cerr << "  --symbols <file>     names of integer tracepoint ids, names kept in module by default\n";
+        cerr << "  --jobs <N>           simplify and analyse functions on N threads, 0 means number of cores\n";
+        cerr << "  --cache <dir>        reuse analyses of functions unchanged since previous runs\n";
+        cerr << "  --costs <file>       costs of instructions, see check_cycles --costs\n";
+        cerr << "  --format text|json   format of results, text by default\n";
+        return 1;
+    }
+
+    TraceReader reader;
+    string error;
+    if (!reader.open(args[1], error))
+    {
+        cerr << argv[0] << ": " << args[1] << ": " << error << "\n";
+        return 1;
+    }
+
+    SMDiagnostic Err;
+    LLVMContext Context;
+    unique_ptr<Module> Mod(loadModule(args[0], Err, Context));
+    if (!Mod)
+    {
+        Err.print(argv[0], errs());
+        return 1;
+    }
+
+    auto symbols = readTracePointNames(*Mod);
+    if (!symbols_path.empty())
+    {
+        ifstream symbols_file(symbols_path);
+        if (!symbols_file || !readSymbolTable(symbols_file, symbols))
+        {
+            cerr << argv[0] << ": " << symbols_path << ": can't read symbol table\n";
+            return 1;
+        }
+    }
+
+    auto replay = TraceReplay(reader, symbols);
+    if (args.size() == 4 && !batch)
+    {
+        replay.setPairs({{args[2], args[3]}});
+    }
+    else if (batch)
+    {
+        // Pairs are read from stdin if file isn't specified or is "-"
+        auto pairs = vector<TracePointPair>();
+        bool read = false;
+        if (args.size() == 3 || args[3] == "-")
+        {
+            read = readTracePointPairs(cin, pairs);
+        }
+        else
+        {
+            ifstream pairs_file(args[3]);
+            if (!pairs_file)
+            {
+                cerr << "Can't open " << args[3] << "\n";
+                return 1;
+            }
+            read = readTracePointPairs(pairs_file, pairs);
+        }
+        if (!read)
+        {
+            return 1;
+        }
+        replay.setPairs(pairs);
+    }
+    if (!replay.run())
+    {
+        cerr << argv[0] << ": " << args[1] << ": truncated trace\n";
+        return 1;
+    }
+
+    // Only functions the observed pairs depend on are materialized
+    auto start_tps = set<TracePoint>();
+    auto final_tps = set<TracePoint>();
+    for (auto &[start_tp, final_tp] : replay.getPairs())
+    {
+        start_tps.insert(start_tp);
+        final_tps.insert(final_tp);
+    }
+    if (auto E = materializeSlice(*Mod, start_tps, final_tps))
+    {
+        logAllUnhandledErrors(move(E), errs(), string(argv[0]) + ": " + args[0] + ": ");
+        return 1;
+    }
+
+    auto searcher = TraceSearcher(*Mod, options);
+    auto checked = vector<CheckedPair>();
+    int ret = 0;
+    for (Index i = 0; i < replay.getPairs().size(); i++)
+    {
+        auto &[start_tp, final_tp] = replay.getPairs()[i];
+        CheckedPair pair = CheckedPair();
+        pair.state = searcher.search(start_tp, final_tp);
+        pair.estimate = searcher.worstCaseCost(start_tp, final_tp);
+        pair.agreement = Agreement::Ok;
+        auto &o = replay.getObserved()[i];
+        bool contained = !pair.state.FinalTPAvoidable;
+        if (o.unnamed)
+        {
+            pair.agreement = Agreement::Unnamed;
+        }
+        else if (o.count && (pair.state.StartTPNotFound || pair.state.FinalTPNotFound))
+        {
+            pair.agreement = Agreement::Contradicts;
+        }
+        else if (o.count && contained &&
+                 (pair.state.FinalTPUnreachable ||
+                  (!pair.state.LoopFound && o.max_iterations > searcher.iterationBound(start_tp))))
+        {
+            pair.agreement = Agreement::Contradicts;
+        }
+        else if (o.count && pair.state.FinalTPUnreachable)
+        {
+            pair.agreement = Agreement::Left;
+        }
+        ret = pair.agreement == Agreement::Contradicts ? 2 : ret;
+        checked.push_back(pair);
+    }
+
+    double ns_per_tick = reader.nanosecondsPerTick();
+    if (json)
+    {
+        writeJson(cout, reader, replay, checked, ns_per_tick);
+    }
+    else
+    {
+        writeText(cout, replay, checked, ns_per_tick);
+    }
+    cout << flush;
+    return ret;
+}
@@ -0,0 +1,398 @@
+#include "trace_point_matrix.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "scc.h"
+#include "utils.h"
+
+using namespace llvm;
+using namespace std;
+
+namespace {
+
+// properties of traces from vertex, bit per final tracepoint
+struct Traits
+{
+    BitVector avoided;
+    BitVector loop_on_trace;
+    BitVector real_loop;
+};
+
+enum : uint8_t
+{
+    Avoided = 1,
+    LoopOnTrace = 2,
+    RealLoop = 4,
+};
+
+// Cyclic component with cycles checker doesn't follow for some final
+// tracepoints: through the final vertex or through branches of call which
+// reaches it. Traits of the component are wrong for them, traits of members
+// for them are kept apart as flags, `finals' per member.
+struct Split
+{
+    vector<Index> finals;
+    vector<uint8_t> flags;
+};
+
+}
+
+TracePointMatrix::TracePointMatrix(const CompactGraph &graph,
+                                   map<TracePoint, Vertex> &label,
+                                   vector < vector<Vertex> > &bounded_loops)
+{
+    Size amtVertices = graph.size();
+    Size amtTPs = label.size();
+
+    vector<Index> tpAt(amtVertices, NoTracePoint);
+    vector<Vertex> vertexOf;
+    for (auto [tp, v] : label)
+    {
+        tpAt[v] = tracepoints.size();
+        tracepoints.push_back(tp);
+        vertexOf.push_back(v);
+    }
+    rows.resize(amtTPs);
+
+    auto finder = SCCFinder(graph);
+    vector<Vertex> all_vertices(amtVertices);
+    iota(all_vertices.begin(), all_vertices.end(), 0);
+    finder.run(all_vertices);
+    auto &components = finder.getComponents();
+    auto componentOf = [&](Vertex v) -> Index { return finder.getComponent(v); };
+
+    // properties of component are dropped once all components with edges to
+    // it are processed
+    vector<Index> position(amtVertices);
+    vector<Size> pending(components.size(), 0);
+    for (Index c = 0; c < components.size(); c++)
+    {
+        for (Index i = 0; i < components[c].size(); i++)
+        {
+            Vertex v = components[c][i];
+            position[v] = i;
+            for (Index e = 0; e < graph.amtTraceEdges(v); e++)
+            {
+                Index to = componentOf(graph.traceEdge(v, e));
+                pending[to] += to != c;
+            }
+        }
+    }
+
+    vector<BitVector> reached(components.size());
+    vector<Traits> traits(components.size());
+    DenseMap<Index, Split> splits;
+
+    // traits of traces from `v' for all final tracepoints, they are loaded
+    // into `loaded' if component of `v' is split
+    auto load = [&](Vertex v, Traits &loaded) -> const Traits & {
+        auto it = splits.find(componentOf(v));
+        if (it == splits.end())
+        {
+            return traits[componentOf(v)];
+        }
+        loaded = traits[componentOf(v)];
+        auto &split = it->second;
+        for (Index k = 0; k < split.finals.size(); k++)
+        {
+            uint8_t flags = split.flags[position[v] * split.finals.size() + k];
+            Index final = split.finals[k];
+            loaded.avoided[final] = flags & Avoided;
+            loaded.loop_on_trace[final] = flags & LoopOnTrace;
+            loaded.real_loop[final] = flags & RealLoop;
+        }
+        return loaded;
+    };
+    // traits of traces from `v' for one final tracepoint
+    auto flagsAt = [&](Vertex v, Index final) -> uint8_t {
+        auto it = splits.find(componentOf(v));
+        if (it != splits.end())
+        {
+            auto &split = it->second;
+            auto k = lower_bound(split.finals.begin(), split.finals.end(), final);
+            if (k != split.finals.end() && *k == final)
+            {
+                return split.flags[position[v] * split.finals.size() + (k - split.finals.begin())];
+            }
+        }
+        auto &to = traits[componentOf(v)];
+        return (to.avoided[final] ? Avoided : 0) | (to.loop_on_trace[final] ? LoopOnTrace : 0)
+               | (to.real_loop[final] ? RealLoop : 0);
+    };
+
+    auto bounded_index = BoundedLoopIndex(amtVertices, bounded_loops);
+    auto subFinder = SCCFinder(graph);
+    Traits loaded;
+    BitVector go_on(amtTPs, true);
+    BitVector scratch;
+    vector<bool> cut_inner;
+
+    auto release = [&](Index c) {
+        reached[c] = BitVector();
+        traits[c] = Traits();
+        splits.erase(c);
+    };
+
+    for (Index c = 0; c < components.size(); c++)
+    {
+        auto &members = components[c];
+        bool cyclic = finder.isCyclic(c);
+
+        reached[c] = BitVector(amtTPs);
+        for (Vertex v : members)
+        {
+            if (tpAt[v] != NoTracePoint)
+            {
+                reached[c].set(tpAt[v]);
+            }
+            for (Index i = 0; i < graph.amtTraceEdges(v); i++)
+            {
+                auto to = componentOf(graph.traceEdge(v, i));
+                if (to != c)
+                {
+                    reached[c] |= reached[to];
+                }
+            }
+        }
+
+        // Traits of the whole component as checker finds them. Vertex which
+        // isn't on a cycle is a component of its own, trace to its
+        // tracepoint ends in it and trace which reached final tracepoint in
+        // called function doesn't go on by its branches.
+        auto &result = traits[c];
+        result = {BitVector(amtTPs), BitVector(amtTPs), BitVector(amtTPs)};
+        for (Vertex v : members)
+        {
+            if (graph.hasCall(v) && componentOf(graph.getCallee(v)) != c)
+            {
+                auto to = graph.getCallee(v);
+                auto &to_reached = reached[componentOf(to)];
+                auto &to_traits = load(to, loaded);
+
+                // called function reached final tracepoint, so state of
+                // `v' is its state, otherwise any loop in it is on trace
+                scratch = to_traits.avoided;
+                scratch &= to_reached;
+                result.avoided |= scratch;
+                scratch = to_traits.loop_on_trace;
+                scratch &= to_reached;
+                result.loop_on_trace |= scratch;
+                scratch = to_traits.real_loop;
+                scratch.reset(to_reached);
+                result.loop_on_trace |= scratch;
+                result.real_loop |= to_traits.real_loop;
+                if (!cyclic)
+                {
+                    go_on.reset(to_reached);
+                }
+            }
+
+            if (graph.successors(v).empty())
+            {
+                result.avoided |= go_on;
+            }
+
+            for (Vertex to : graph.successors(v))
+            {
+                if (componentOf(to) == c)
+                {
+                    continue;
+                }
+                auto &to_traits = load(to, loaded);
+                auto &to_reached = reached[componentOf(to)];
+                scratch = to_traits.avoided;
+                scratch &= go_on;
+                result.avoided |= scratch;
+                scratch = to_traits.real_loop;
+                scratch &= go_on;
+                result.real_loop |= scratch;
+                scratch = to_traits.loop_on_trace;
+                scratch &= go_on;
+                scratch &= to_reached;
+                result.loop_on_trace |= scratch;
+            }
+
+            if (!cyclic && tpAt[v] != NoTracePoint)
+            {
+                result.avoided.reset(tpAt[v]);
+                result.loop_on_trace.reset(tpAt[v]);
+                result.real_loop.reset(tpAt[v]);
+            }
+            go_on.set();
+        }
+        if (cyclic && !bounded_index.isBounded(members))
+        {
+            result.loop_on_trace.set();
+            result.real_loop.set();
+        }
+
+        // final tracepoints for which cyclic component is split
+        BitVector split_finals(amtTPs);
+        for (Vertex v : members)
+        {
+            if (cyclic && tpAt[v] != NoTracePoint)
+            {
+                split_finals.set(tpAt[v]);
+            }
+            if (cyclic && graph.hasCall(v) && componentOf(graph.getCallee(v)) != c)
+            {
+                split_finals |= reached[componentOf(graph.getCallee(v))];
+            }
+        }
+
+        if (split_finals.any())
+        {
+            auto &split = splits[c];
+            for (Index final : split_finals.set_bits())
+            {
+                split.finals.push_back(final);
+            }
+            Size amtFinals = split.finals.size();
+            split.flags.assign(members.size() * amtFinals, 0);
+
+            for (Index k = 0; k < amtFinals; k++)
+            {
+                Index final = split.finals[k];
+                Vertex final_v = vertexOf[final];
+                // Branches of call which reaches final tracepoint are cut
+                // off. Checker cuts them for called function of the same
+                // component too if it isn't on DFS stack, which is taken
+                // for called function ending in another sub-component.
+                cut_inner.assign(members.size(), false);
+                auto cuts = [&](Vertex w) {
+                    if (!graph.hasCall(w))
+                    {
+                        return false;
+                    }
+                    auto callee = componentOf(graph.getCallee(w));
+                    return callee == c ? cut_inner[position[w]] : reached[callee].test(final);
+                };
+                bool changed;
+                do
+                {
+                    subFinder.run(
+                        members,
+                        [&](Vertex w) { return componentOf(w) == c; },
+                        [&](Vertex w) -> Size {
+                            return w == final_v ? 0 : cuts(w) ? 1 : graph.amtTraceEdges(w);
+                        });
+                    changed = false;
+                    for (Vertex v : members)
+                    {
+                        if (v != final_v && graph.hasCall(v) && componentOf(graph.getCallee(v)) == c
+                            && subFinder.getComponent(graph.getCallee(v)) != subFinder.getComponent(v)
+                            && !cut_inner[position[v]])
+                        {
+                            cut_inner[position[v]] = true;
+                            changed = true;
+                        }
+                    }
+                } while (changed);
+
+                // sub-components are completed in reverse topological order
+                // too, members reach final tracepoint and `final_v' is a
+                // sub-component of its own without any properties
+                auto &subComponents = subFinder.getComponents();
+                auto flagsOf = [&](Vertex w) -> uint8_t {
+                    return componentOf(w) == c ? split.flags[position[w] * amtFinals + k] : flagsAt(w, final);
+                };
+                auto reaches = [&](Vertex w) { return componentOf(w) == c || reached[componentOf(w)].test(final); };
+                for (Index sc = 0; sc < subComponents.size(); sc++)
+                {
+                    auto inSub = [&](Vertex w) { return componentOf(w) == c && subFinder.getComponent(w) == sc; };
+                    uint8_t flags = 0;
+                    for (Vertex v : subComponents[sc])
+                    {
+                        if (v == final_v)
+                        {
+                            continue;
+                        }
+                        if (graph.hasCall(v) && !inSub(graph.getCallee(v)))
+                        {
+                            auto to = graph.getCallee(v);
+                            uint8_t to_flags = flagsOf(to);
+                            flags |= reaches(to) ? to_flags & (Avoided | LoopOnTrace)
+                                                 : (to_flags & RealLoop ? LoopOnTrace : 0);
+                            flags |= to_flags & RealLoop;
+                        }
+                        if (cuts(v))
+                        {
+                            continue;
+                        }
+                        flags |= graph.successors(v).empty() ? Avoided : 0;
+                        for (Vertex to : graph.successors(v))
+                        {
+                            if (inSub(to))
+                            {
+                                continue;
+                            }
+                            uint8_t to_flags = flagsOf(to);
+                            flags |= to_flags & (Avoided | RealLoop);
+                            flags |= reaches(to) ? to_flags & LoopOnTrace : 0;
+                        }
+                    }
+                    if (subFinder.isCyclic(sc) && !bounded_index.isBounded(subComponents[sc]))
+                    {
+                        flags |= LoopOnTrace | RealLoop;
+                    }
+                    for (Vertex v : subComponents[sc])
+                    {
+                        split.flags[position[v] * amtFinals + k] = v == final_v ? 0 : flags;
+                    }
+                }
+            }
+        }
+
+        for (Vertex v : members)
+        {
+            if (tpAt[v] != NoTracePoint)
+            {
+                auto &v_traits = load(v, loaded);
+                auto &row = rows[tpAt[v]];
+                row.reached = reached[c];
+                row.reached.reset(tpAt[v]);
+                row.loop_on_trace = v_traits.loop_on_trace;
+                row.avoided = v_traits.avoided;
+            }
+        }
+
+        for (Vertex v : members)
+        {
+            for (Index i = 0; i < graph.amtTraceEdges(v); i++)
+            {
+                auto to = componentOf(graph.traceEdge(v, i));
+                if (to != c && --pending[to] == 0)
+                {
+                    release(to);
+                }
+            }
+        }
+        if (pending[c] == 0)
+        {
+            release(c);
+        }
+    }
+}
+
+ostream &operator<<(ostream &out, const TracePointMatrix &matrix)
+{
+    auto &tracepoints = matrix.getTracePoints();
+    for (auto &tp : tracepoints)
+    {
+        out << "\t" << tp;
+    }
+    out << "\n";
+    for (Index start = 0; start < tracepoints.size(); start++)
+    {
+        out << tracepoints[start];
+        for (Index final = 0; final < tracepoints.size(); final++)
+        {
+            out << "\t" << matrix.get(start, final).to_int();
+        }
+        out << "\n";
+    }
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "llvm/ADT/BitVector.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "types.h"
+#include "compact_graph.h"
+#include "searching_state.h"
+
+// computes SearchingState of every pair of tracepoints in one sweep over the
+// condensation of the graph (call edges included) instead of running a DFS per
+// pair: components are processed in reverse topological order and properties
+// of traces are propagated as bitsets indexed by final tracepoint. Only
+// cyclic components which hold a final tracepoint or call a function reaching
+// it are split for that final tracepoint, as checker doesn't follow their
+// cycles through it.
+class TracePointMatrix
+{
+private:
+    struct Row
+    {
+        llvm::BitVector reached;
+        llvm::BitVector loop_on_trace;
+        llvm::BitVector avoided;
+    };
+
+    enum : Index { NoTracePoint = ~0u };
+
+    std::vector<TracePoint> tracepoints;
+    std::vector<Row> rows;
+
+public:
+    TracePointMatrix(const CompactGraph &graph,
+                     std::map<TracePoint, Vertex> &label,
+                     std::vector < std::vector<Vertex> > &bounded_loops);
+
+    const std::vector<TracePoint> &getTracePoints() const { return tracepoints; }
+
+    SearchingState get(Index start, Index final) const
+    {
+        SearchingState state = SearchingState();
+        if (start != final)
+        {
+            state.FinalTPUnreachable = !rows[start].reached[final];
+            state.LoopFound = rows[start].loop_on_trace[final];
+            state.FinalTPAvoidable = rows[start].avoided[final];
+        }
+        return state;
+    }
+};
+
+// matrix of states, start tracepoints are rows and final tracepoints are
+// columns, fields are tab separated
+std::ostream &operator<<(std::ostream &out, const TracePointMatrix &matrix);
@@ -0,0 +1,131 @@
+#include "trace_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+// records per read
+static const uint64_t ChunkSize = 1 << 14;
+
+TraceReader::~TraceReader()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool TraceReader::open(const string &path, string &error)
+{
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    if (!readAt(0, &header, sizeof(header)) || memcmp(header.magic, BESC_TRACE_MAGIC, sizeof(header.magic)))
+    {
+        error = "not a trace file";
+        return false;
+    }
+    if (header.version != BESC_TRACE_VERSION)
+    {
+        error = "unsupported version " + to_string(header.version);
+        return false;
+    }
+    // rings are padded, they fill the space before names
+    if (!header.max_threads || !header.ring_size || header.names_offset < header.rings_offset ||
+        (ring_bytes = (header.names_offset - header.rings_offset) / header.max_threads) <
+            sizeof(besc_trace_ring) + header.ring_size * sizeof(besc_trace_record))
+    {
+        error = "malformed header";
+        return false;
+    }
+
+    auto amt_names = min(header.amt_names, header.max_names);
+    auto table = vector<char>(uint64_t(amt_names) * header.name_size);
+    if (!readAt(header.names_offset, table.data(), table.size()))
+    {
+        error = "truncated names";
+        return false;
+    }
+    for (Index i = 0; i < amt_names; i++)
+    {
+        const char *name = table.data() + uint64_t(i) * header.name_size;
+        names.emplace_back(name, strnlen(name, header.name_size));
+        // recorder cuts longer names and drops their terminating zero
+        truncated.push_back(names.back().size() == header.name_size);
+    }
+    return true;
+}
+
+Size TraceReader::amtRings() const
+{
+    return min(header.amt_threads, header.max_threads);
+}
+
+bool TraceReader::readRing(Index ring, Ring &info,
+                           const function<void(const besc_trace_record *, Size)> &consume) const
+{
+    uint64_t offset = header.rings_offset + ring * ring_bytes;
+    besc_trace_ring ring_header;
+    if (!readAt(offset, &ring_header, sizeof(ring_header)))
+    {
+        return false;
+    }
+    info.thread = ring_header.thread;
+    info.amt_records = ring_header.amt_records;
+    info.amt_kept = min<uint64_t>(info.amt_records, header.ring_size);
+
+    auto chunk = vector<besc_trace_record>(min(ChunkSize, info.amt_kept));
+    uint64_t records = offset + sizeof(besc_trace_ring);
+    for (uint64_t k = info.amt_records - info.amt_kept; k < info.amt_records;)
+    {
+        // chunk ends at the end of ring, the rest is read from its start
+        uint64_t position = k % header.ring_size;
+        uint64_t amount = min({ChunkSize, info.amt_records - k, header.ring_size - position});
+        if (!readAt(records + position * sizeof(besc_trace_record), chunk.data(),
+                    amount * sizeof(besc_trace_record)))
+        {
+            return false;
+        }
+        consume(chunk.data(), amount);
+        k += amount;
+    }
+    return true;
+}
+
+double TraceReader::nanosecondsPerTick() const
+{
+    if (header.clock == BESC_TRACE_CLOCK_MONOTONIC)
+    {
+        return 1;
+    }
+    if (!header.end_ns || header.end_ticks <= header.start_ticks)
+    {
+        return 0;
+    }
+    return double(header.end_ns - header.start_ns) / (header.end_ticks - header.start_ticks);
+}
+
+bool TraceReader::readAt(uint64_t offset, void *data, uint64_t size) const
+{
+    auto *bytes = static_cast<char *>(data);
+    while (size)
+    {
+        auto amount = pread(fd, bytes, size, offset);
+        if (amount <= 0)
+        {
+            return false;
+        }
+        bytes += amount;
+        offset += amount;
+        size -= amount;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "runtime/besc_trace.h"
+
+// Reads dump file of runtime recorder (see runtime/besc_trace.h) without
+// loading it: records of ring are read in chunks in order of writing. File
+// of running process may be read, records written after the ring header is
+// read are skipped.
+class TraceReader
+{
+public:
+    struct Ring
+    {
+        uint64_t thread;
+        // records ever written and records still kept by ring
+        uint64_t amt_records;
+        uint64_t amt_kept;
+    };
+
+private:
+    int fd = -1;
+    besc_trace_header header;
+    uint64_t ring_bytes = 0;
+    std::vector<std::string> names;
+    std::vector<bool> truncated;
+
+public:
+    TraceReader() = default;
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+    ~TraceReader();
+
+    // false and `error' if file can't be read or isn't a trace
+    bool open(const std::string &path, std::string &error);
+
+    const besc_trace_header &getHeader() const { return header; }
+
+    // rings of threads which have hit tracepoints
+    Size amtRings() const;
+
+    // calls `consume' on consecutive chunks of records kept by ring
+    bool readRing(Index ring, Ring &info,
+                  const std::function<void(const besc_trace_record *, Size)> &consume) const;
+
+    // names of besc_tracepoint() calls, index of name is in records
+    const std::vector<std::string> &getNames() const { return names; }
+
+    // name is only a prefix of the name of the call
+    bool isTruncated(Index name) const { return truncated[name]; }
+
+    // by clock samples at start and exit of process, 0 if process hasn't
+    // exited and clock isn't in nanoseconds
+    double nanosecondsPerTick() const;
+
+private:
+    bool readAt(uint64_t offset, void *data, uint64_t size) const;
+};
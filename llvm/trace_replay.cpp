@@ -0,0 +1,210 @@
+#include "trace_replay.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+using namespace std;
+
+// records of tracepoints whose names didn't fit into the trace
+static const TracePoint UnknownTracePoint = "<unknown>";
+
+TraceReplay::TraceReplay(TraceReader &reader_, const vector<TracePoint> &symbols_)
+    : reader(reader_),
+      symbols(symbols_),
+      named_index(reader_.getNames().size(), NoTracePoint)
+{
+}
+
+void TraceReplay::setPairs(const vector<TracePointPair> &pairs_)
+{
+    all_pairs = false;
+    for (auto &[start_tp, final_tp] : pairs_)
+    {
+        addPair(addTracePoint(start_tp), addTracePoint(final_tp));
+    }
+}
+
+bool TraceReplay::run()
+{
+    for (Index ring = 0; ring < reader.amtRings(); ring++)
+    {
+        TraceReader::Ring info;
+        bool read;
+        if (all_pairs)
+        {
+            Index previous = NoTracePoint;
+            uint64_t previous_time = 0;
+            read = reader.readRing(ring, info, [&](const besc_trace_record *records, Size amount) {
+                replayConsecutive(records, amount, previous, previous_time);
+            });
+        }
+        else
+        {
+            // traces don't continue in other threads
+            auto windows = vector<Window>(pairs.size());
+            read = reader.readRing(ring, info, [&](const besc_trace_record *records, Size amount) {
+                replayGiven(records, amount, windows);
+            });
+        }
+        if (!read)
+        {
+            return false;
+        }
+        amt_records += info.amt_kept;
+    }
+
+    if (all_pairs)
+    {
+        auto order = vector<Index>(pairs.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](Index l, Index r) { return pairs[l] < pairs[r]; });
+        auto sorted_pairs = vector<TracePointPair>();
+        auto sorted_observed = vector<ObservedPair>();
+        for (Index i : order)
+        {
+            sorted_pairs.push_back(pairs[i]);
+            sorted_observed.push_back(observed[i]);
+        }
+        pairs = move(sorted_pairs);
+        observed = move(sorted_observed);
+    }
+    return true;
+}
+
+Index TraceReplay::addTracePoint(const TracePoint &tp)
+{
+    auto it = tracepoint_index.insert({tp, tracepoints.size()});
+    if (it.second)
+    {
+        tracepoints.push_back(tp);
+        unnamed.push_back(false);
+        starting.emplace_back();
+        ending.emplace_back();
+    }
+    return it.first->second;
+}
+
+Index TraceReplay::addPair(Index start, Index final)
+{
+    Index pair = pairs.size();
+    pairs.push_back({tracepoints[start], tracepoints[final]});
+    observed.emplace_back();
+    observed.back().unnamed = unnamed[start] || unnamed[final];
+    starting[start].push_back(pair);
+    ending[final].push_back(pair);
+    return pair;
+}
+
+Index TraceReplay::addPrefix(const string &prefix)
+{
+    auto found = vector<Index>();
+    for (auto it = tracepoint_index.lower_bound(prefix);
+         it != tracepoint_index.end() && !it->first.compare(0, prefix.size(), prefix); it++)
+    {
+        if (!unnamed[it->second])
+        {
+            found.push_back(it->second);
+        }
+    }
+    if (found.size() == 1)
+    {
+        return found[0];
+    }
+    Index tp = addTracePoint(prefix + "...");
+    unnamed[tp] = true;
+    return tp;
+}
+
+Index TraceReplay::indexOf(uint32_t tracepoint)
+{
+    if ((tracepoint & BESC_TRACE_NAMED) && tracepoint != BESC_TRACE_UNKNOWN)
+    {
+        Index name = tracepoint & ~BESC_TRACE_NAMED;
+        // names are read before records, a name may be added meanwhile
+        if (name >= named_index.size())
+        {
+            return addTracePoint(to_string(tracepoint));
+        }
+        if (named_index[name] == NoTracePoint)
+        {
+            auto &tp_name = reader.getNames()[name];
+            named_index[name] = reader.isTruncated(name) ? addPrefix(tp_name) : addTracePoint(tp_name);
+        }
+        return named_index[name];
+    }
+
+    auto it = id_index.find(tracepoint);
+    if (it != id_index.end())
+    {
+        return it->second;
+    }
+    // ids out of symbols are named by their numbers, as getTracePoint() does
+    TracePoint tp = tracepoint == BESC_TRACE_UNKNOWN ? UnknownTracePoint
+                    : tracepoint < symbols.size()   ? symbols[tracepoint]
+                                                    : to_string(tracepoint);
+    Index index = addTracePoint(tp);
+    unnamed[index] = unnamed[index] || tracepoint == BESC_TRACE_UNKNOWN;
+    return id_index[tracepoint] = index;
+}
+
+void TraceReplay::replayGiven(const besc_trace_record *records, Size amount, vector<Window> &windows)
+{
+    for (Size i = 0; i < amount; i++)
+    {
+        auto &record = records[i];
+        Index tp = indexOf(record.tracepoint);
+        // trace of pair of the same tracepoint ends before the next begins
+        for (Index pair : ending[tp])
+        {
+            auto &window = windows[pair];
+            if (!window.open)
+            {
+                continue;
+            }
+            auto &pair_observed = observed[pair];
+            uint64_t ticks = record.timestamp > window.start ? record.timestamp - window.start : 0;
+            pair_observed.count++;
+            pair_observed.total_ticks += ticks;
+            pair_observed.max_ticks = max(pair_observed.max_ticks, ticks);
+            pair_observed.max_iterations = max(pair_observed.max_iterations, window.iterations);
+            window.open = false;
+        }
+        for (Index pair : starting[tp])
+        {
+            auto &window = windows[pair];
+            if (window.open)
+            {
+                window.iterations++;
+            }
+            else
+            {
+                window = {true, record.timestamp, 1};
+            }
+        }
+    }
+}
+
+void TraceReplay::replayConsecutive(const besc_trace_record *records, Size amount, Index &previous,
+                                    uint64_t &previous_time)
+{
+    for (Size i = 0; i < amount; i++)
+    {
+        auto &record = records[i];
+        Index tp = indexOf(record.tracepoint);
+        if (previous != NoTracePoint)
+        {
+            uint64_t key = uint64_t(previous) << 32 | tp;
+            auto it = consecutive.find(key);
+            Index pair = it != consecutive.end() ? it->second : consecutive[key] = addPair(previous, tp);
+            auto &pair_observed = observed[pair];
+            uint64_t ticks = record.timestamp > previous_time ? record.timestamp - previous_time : 0;
+            pair_observed.count++;
+            pair_observed.total_ticks += ticks;
+            pair_observed.max_ticks = max(pair_observed.max_ticks, ticks);
+            pair_observed.max_iterations = 1;
+        }
+        previous = tp;
+        previous_time = record.timestamp;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+#include "incremental.h"
+#include "trace_reader.h"
+
+// traces of pair of tracepoints seen in recorded trace, times are in ticks
+// of clock of the trace
+struct ObservedPair
+{
+    uint64_t count = 0;
+    uint64_t max_ticks = 0;
+    uint64_t total_ticks = 0;
+    // the most hits of start tracepoint in one trace
+    uint64_t max_iterations = 0;
+    // a tracepoint of pair is known by prefix of its name or not at all
+    bool unnamed = false;
+};
+
+// Replays records of every thread of recorded trace and measures traces
+// between tracepoints. Trace of pair begins at hit of start tracepoint and
+// ends at the next hit of final tracepoint by the same thread, further hits
+// of start tracepoint before it are iterations of the trace. If pairs
+// aren't given, every two consecutive hits of a thread are trace of their
+// pair, all such pairs are observed. Cut name of trace is the tracepoint of
+// given pair whose name it's the only prefix of.
+class TraceReplay
+{
+private:
+    enum : Index { NoTracePoint = ~0u };
+
+    // open trace of pair in the replayed ring
+    struct Window
+    {
+        bool open = false;
+        uint64_t start = 0;
+        uint64_t iterations = 0;
+    };
+
+    TraceReader &reader;
+    // names of integer tracepoint ids
+    std::vector<TracePoint> symbols;
+
+    std::vector<TracePoint> tracepoints;
+    std::map<TracePoint, Index> tracepoint_index;
+    std::vector<bool> unnamed;
+    // indices of tracepoints of records, named ones and ids apart
+    std::vector<Index> named_index;
+    std::unordered_map<uint32_t, Index> id_index;
+
+    bool all_pairs = true;
+    std::vector<TracePointPair> pairs;
+    std::vector<ObservedPair> observed;
+    // pairs by index of their start and final tracepoints
+    std::vector<std::vector<Index>> starting;
+    std::vector<std::vector<Index>> ending;
+    // pairs of consecutive tracepoints by both indices
+    std::unordered_map<uint64_t, Index> consecutive;
+
+    uint64_t amt_records = 0;
+
+public:
+    TraceReplay(TraceReader &reader_, const std::vector<TracePoint> &symbols_);
+
+    // only the pairs are observed
+    void setPairs(const std::vector<TracePointPair> &pairs_);
+
+    // false if trace can't be read. Observed pairs which weren't given are
+    // sorted.
+    bool run();
+
+    const std::vector<TracePointPair> &getPairs() const { return pairs; }
+
+    // i-th is of i-th pair
+    const std::vector<ObservedPair> &getObserved() const { return observed; }
+
+    uint64_t amtRecords() const { return amt_records; }
+
+private:
+    Index addTracePoint(const TracePoint &tp);
+
+    Index addPair(Index start, Index final);
+
+    // tracepoint whose name is the only one to begin with `prefix', new
+    // unnamed one otherwise
+    Index addPrefix(const std::string &prefix);
+
+    // index of tracepoint of record
+    Index indexOf(uint32_t tracepoint);
+
+    void replayGiven(const besc_trace_record *records, Size amount, std::vector<Window> &windows);
+
+    void replayConsecutive(const besc_trace_record *records, Size amount, Index &previous, uint64_t &previous_time);
+};
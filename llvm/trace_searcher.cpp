@@ -0,0 +1,602 @@
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+
+#include "trace_searcher.h"
+
+#include "bounded_loops.h"
+#include "graph_creator.h"
+#include "module_loader.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace llvm;
+using namespace std;
+
+// the most expensive functions go first
+static void printPipelineTiming(vector<FunctionTiming> timings, unsigned workers)
+{
+    stable_sort(timings.begin(), timings.end(),
+                [](const FunctionTiming &a, const FunctionTiming &b) { return a.seconds > b.seconds; });
+
+    double total = 0;
+    for (auto &timing : timings)
+    {
+        total += timing.seconds;
+    }
+
+    ostringstream report;
+    report << fixed << setprecision(6);
+    report << "O1 pipeline: " << total << " s in " << timings.size() << " functions on " << workers << " threads\n";
+    for (auto &timing : timings)
+    {
+        report << "  " << timing.seconds << "  " << timing.name << "\n";
+    }
+    cerr << report.str();
+}
+
+// empty if module has no names of tracepoint ids, hex digest of them
+// otherwise, since labels of cached fragments depend on them
+static string namesFingerprint(const vector<TracePoint> &names)
+{
+    if (names.empty())
+    {
+        return "";
+    }
+    MD5 md5;
+    for (auto &name : names)
+    {
+        md5.update(name);
+        md5.update(StringRef("\n"));
+    }
+    MD5::MD5Result result;
+    md5.final(result);
+    return result.digest().str().str();
+}
+
+TraceSearcher::TraceSearcher(Module &M, SearchOptions options)
+    : stats(options.stats)
+{
+    if (options.workers == 0)
+    {
+        options.workers = max(thread::hardware_concurrency(), 1u);
+    }
+
+    // stages are recorded to a local if stats aren't requested
+    auto unused = Stats();
+    auto &run_stats = stats ? *stats : unused;
+
+    run_stats.begin("O1 pipeline");
+    auto timings = vector<FunctionTiming>();
+    runO1OptimizationPass(M, options.workers, &timings);
+    run_stats.count("functions", timings.size());
+    if (options.pipeline_timing)
+    {
+        printPipelineTiming(timings, options.workers);
+    }
+
+    // Fragments of functions unchanged since they were cached are
+    // reused, the rest functions are analysed
+    run_stats.begin("cache");
+    unique_ptr<AnalysisCache> cache;
+    if (!options.cache_dir.empty())
+    {
+        cache = make_unique<AnalysisCache>(options.cache_dir);
+    }
+
+    auto names = readTracePointNames(M);
+    auto key_suffix = options.costs.fingerprint() + namesFingerprint(names);
+    auto functions = vector<Function *>();
+    auto fragments = vector<FunctionFragment>();
+    auto keys = vector<string>();
+    auto missed = vector<Index>();
+    for (auto &F : M)
+    {
+        functions.push_back(&F);
+        fragments.emplace_back();
+        keys.push_back(cache ? hashFunction(F) + key_suffix : "");
+        if (!cache || !cache->load(keys.back(), fragments.back()))
+        {
+            missed.push_back(functions.size() - 1);
+        }
+    }
+
+    auto missed_functions = vector<Function *>();
+    for (auto i : missed)
+    {
+        missed_functions.push_back(functions[i]);
+    }
+    run_stats.count("cached_functions", functions.size() - missed.size());
+    run_stats.count("analysed_functions", missed.size());
+
+    run_stats.begin("loops");
+    auto trip_counts = vector<vector<uint64_t>>();
+    auto block_groups = extractBlocksGroupedByLoops(M, missed_functions, options.workers, &trip_counts);
+    for (auto &groups : block_groups)
+    {
+        run_stats.count("bounded_loops", groups.size());
+    }
+
+    run_stats.begin("graph");
+    for (Index j = 0; j < missed.size(); j++)
+    {
+        auto GC = GraphCreator(*missed_functions[j], options.costs, names);
+        auto blockIdx = GC.getBlockIdx();
+        auto &fragment = fragments[missed[j]];
+        fragment = GC.getFragment();
+
+        for (auto &group : block_groups[j])
+        {
+            vector<Index> loop = {};
+            for (auto *block : group)
+            {
+                loop.push_back(blockIdx[block]);
+            }
+            fragment.bounded_loops.push_back(loop);
+        }
+        fragment.loop_trip_counts = trip_counts[j];
+
+        if (cache)
+        {
+            cache->store(keys[missed[j]], fragment);
+        }
+    }
+
+    joinFragments(functions, fragments);
+    if (cache)
+    {
+        for (Index i = 0; i < functions.size(); i++)
+        {
+            state.function_hash[functions[i]->getName().str()] = keys[i];
+        }
+    }
+
+    run_stats.count("vertices", graph.size());
+    run_stats.count("edges", graph.amtEdges());
+    run_stats.count("call_edges", graph.amtCalls());
+    run_stats.count("bounded_loops", bounded_loops.size());
+    run_stats.count("tracepoints", label.size());
+
+    run_stats.begin("summaries");
+    cyclesChecker = make_unique<CyclesChecker>(graph, bounded_loops, label);
+
+    // queries are answered until the owner of stats ends the stage
+    run_stats.begin("checks");
+}
+
+SearchingState TraceSearcher::search(const TracePoint &start_tp, const TracePoint &final_tp)
+{
+    SearchingState state = SearchingState();
+
+    state.StartTPNotFound = label.find(start_tp) == label.end();
+    state.FinalTPNotFound = label.find(final_tp) == label.end();
+
+    // Early return to avoid pointless loops finding, etc.
+    if (state.StartTPNotFound || state.FinalTPNotFound)
+    {
+        return state;
+    }
+
+    auto start_v = label[start_tp];
+    auto final_v = label[final_tp];
+
+    // LoopsFinder still has to collect info about final tp reachability,
+    // so we reuse it as a side effect.
+    auto ccStatus = cyclesChecker->check(start_v, final_v);
+    countCheck();
+
+    state.LoopFound = ccStatus.loop_on_trace_found;
+    state.FinalTPUnreachable = ! ccStatus.reached_final_tp;
+    state.FinalTPAvoidable = ccStatus.avoided_final_tp;
+    return state;
+}
+
+CostEstimate TraceSearcher::worstCaseCost(const TracePoint &start_tp, const TracePoint &final_tp)
+{
+    CostEstimate estimate = CostEstimate();
+
+    estimate.state.StartTPNotFound = label.find(start_tp) == label.end();
+    estimate.state.FinalTPNotFound = label.find(final_tp) == label.end();
+    if (estimate.state.StartTPNotFound || estimate.state.FinalTPNotFound)
+    {
+        return estimate;
+    }
+
+    if (!wcetEstimator)
+    {
+        wcetEstimator = make_unique<WcetEstimator>(graph, vertex_cost, bounded_loops, loop_trip_counts);
+    }
+    auto start_v = label[start_tp];
+    auto final_v = label[final_tp];
+    cyclesChecker->check(start_v, final_v);
+    countCheck();
+    estimate.state.FinalTPUnreachable = !wcetEstimator->estimate(start_v, final_v, *cyclesChecker, estimate.cost);
+    estimate.state.LoopFound = !estimate.state.FinalTPUnreachable && estimate.cost == WcetEstimator::Unbounded;
+    return estimate;
+}
+
+uint64_t TraceSearcher::iterationBound(const TracePoint &tp) const
+{
+    auto it = label.find(tp);
+    uint64_t bound = 1;
+    for (Index loop = 0; it != label.end() && loop < bounded_loops.size(); loop++)
+    {
+        auto &vertices = bounded_loops[loop];
+        if (find(vertices.begin(), vertices.end(), it->second) == vertices.end())
+        {
+            continue;
+        }
+        uint64_t count = loop_trip_counts[loop];
+        bound = count && bound > WcetEstimator::Unbounded / count ? WcetEstimator::Unbounded : bound * count;
+    }
+    return bound;
+}
+
+void TraceSearcher::countCheck()
+{
+    if (!stats)
+    {
+        return;
+    }
+    auto &counters = cyclesChecker->getCounters();
+    stats->count("checks");
+    stats->count("visited_vertices", counters.visited_vertices);
+    stats->count("followed_edges", counters.followed_edges);
+    stats->count("back_edges", counters.back_edges);
+    stats->count("components", counters.components);
+    stats->count("summaries_used", counters.summaries_used);
+}
+
+vector<TracePoint> TraceSearcher::getTracePoints() const
+{
+    vector<TracePoint> tracepoints;
+    for (auto &[tp, v] : label)
+    {
+        tracepoints.push_back(tp);
+    }
+    return tracepoints;
+}
+
+// Part of block which is a vertex of graph. Part starts with the block, with
+// tracepoint or with call of function which has body, calls of functions
+// without bodies don't change traces and stay in previous part. Indirect
+// call with several possible callees is a part with vertex per callee, trace
+// goes through one of them.
+struct BlockPart
+{
+    bool labeled = false;
+    Index label = 0;
+    // called functions by index in module order
+    vector<Index> callees;
+    // costs of instructions of the part, calls without body included
+    uint64_t cost = 0;
+
+    Size amtVertices() const { return max<Size>(callees.size(), 1); }
+};
+
+// Vertices of function are numbered after vertices of previous functions in
+// module order, parts of block are numbered in order of the block, call goes
+// to the first vertex of callee if callee has body
+void TraceSearcher::joinFragments(const vector<Function *> &functions, const vector<FunctionFragment> &fragments)
+{
+    // indirect call may go to any function of its type whose address is taken
+    auto function_idx = map<string, Index>();
+    auto address_taken = map<string, vector<Index>>();
+    for (Index i = 0; i < functions.size(); i++)
+    {
+        if (fragments[i].size() > 0)
+        {
+            function_idx[functions[i]->getName().str()] = i;
+            if (functions[i]->hasAddressTaken())
+            {
+                address_taken[printType(functions[i]->getFunctionType())].push_back(i);
+            }
+        }
+    }
+
+    // first vertices of blocks, the last one is followed by the first vertex
+    // of the next function
+    auto parts = vector<vector<vector<BlockPart>>>(functions.size());
+    auto first = vector<vector<Vertex>>(functions.size());
+    Size amtVertices = 0;
+    for (Index i = 0; i < functions.size(); i++)
+    {
+        auto &fragment = fragments[i];
+        auto name = functions[i]->getName().str();
+        auto &called = callees[name];
+        bool indirect = false;
+
+        // segments of costs go in order of events of blocks
+        Index c = 0, l = 0, leading = 0, s = 0;
+        parts[i].resize(fragment.size());
+        for (Index b = 0; b < fragment.size(); b++)
+        {
+            auto &block_parts = parts[i][b];
+            block_parts.emplace_back();
+            block_parts.back().cost = fragment.costs[s++];
+            first[i].push_back(amtVertices);
+
+            // labels go before call with the same number, block part is
+            // started by them unless it's the head of block without events
+            bool head = true;
+            Index k = 0;
+            auto addLabels = [&]() {
+                for (; l < fragment.labels.size() && fragment.label_blocks[l] == b && fragment.label_calls[l] <= k; l++)
+                {
+                    if (!head)
+                    {
+                        block_parts.emplace_back();
+                    }
+                    block_parts.back().labeled = true;
+                    block_parts.back().label = l;
+                    block_parts.back().cost += fragment.costs[s++];
+                    head = false;
+                }
+            };
+            bool leads = leading < fragment.leading_calls.size() && fragment.leading_calls[leading] == b;
+            leading += leads;
+            for (; c < fragment.call_blocks.size() && fragment.call_blocks[c] == b; c++, k++)
+            {
+                addLabels();
+
+                auto targets = vector<Index>();
+                if (!fragment.callees[c].empty())
+                {
+                    called.push_back(fragment.callees[c]);
+                    auto callee = function_idx.find(fragment.callees[c]);
+                    if (callee != function_idx.end())
+                    {
+                        targets.push_back(callee->second);
+                    }
+                }
+                else
+                {
+                    indirect = true;
+                    auto candidates = address_taken.find(fragment.call_types[c]);
+                    if (candidates != address_taken.end())
+                    {
+                        targets = candidates->second;
+                    }
+                }
+                if (targets.empty())
+                {
+                    block_parts.back().cost += fragment.costs[s++];
+                    continue;
+                }
+
+                // the first call of block is in the head of block only if
+                // it's the first instruction, as if the block were split by
+                // calls
+                if (!(head && k == 0 && leads && targets.size() == 1))
+                {
+                    block_parts.emplace_back();
+                }
+                block_parts.back().callees = targets;
+                block_parts.back().cost += fragment.costs[s++];
+                head = false;
+            }
+            addLabels();
+
+            for (auto &part : block_parts)
+            {
+                amtVertices += part.amtVertices();
+            }
+        }
+        first[i].push_back(amtVertices);
+
+        if (indirect)
+        {
+            // changes of any function may change callees of indirect calls
+            for (auto *F : functions)
+            {
+                called.push_back(F->getName().str());
+            }
+        }
+    }
+
+    graph = CompactGraph();
+    graph.reserve(amtVertices);
+    vertex_cost.reserve(amtVertices);
+    for (Index i = 0; i < functions.size(); i++)
+    {
+        auto &fragment = fragments[i];
+        for (Index b = 0; b < fragment.size(); b++)
+        {
+            auto &block_parts = parts[i][b];
+            for (Index p = 0; p < block_parts.size(); p++)
+            {
+                auto &part = block_parts[p];
+                for (Index a = 0; a < part.amtVertices(); a++)
+                {
+                    auto v = graph.addVertex();
+                    vertex_cost.push_back(part.cost);
+                    if (!part.callees.empty())
+                    {
+                        graph.setCallee(v, first[part.callees[a]][0]);
+                    }
+                    if (part.labeled)
+                    {
+                        label[fragment.labels[part.label]] = v;
+                        state.label_function[fragment.labels[part.label]] = functions[i]->getName().str();
+                    }
+
+                    if (p + 1 < block_parts.size())
+                    {
+                        // vertices of the next part follow vertices of this one
+                        Vertex next = v + part.amtVertices() - a;
+                        for (Index n = 0; n < block_parts[p + 1].amtVertices(); n++)
+                        {
+                            graph.addEdge(next + n);
+                        }
+                        continue;
+                    }
+                    for (Index e = fragment.offsets[b]; e < fragment.offsets[b + 1]; e++)
+                    {
+                        graph.addEdge(first[i][fragment.targets[e]]);
+                    }
+                }
+            }
+        }
+        for (auto &loop : fragment.bounded_loops)
+        {
+            vector<Vertex> vertex_loop = {};
+            for (auto b : loop)
+            {
+                for (Vertex v = first[i][b]; v < first[i][b + 1]; v++)
+                {
+                    vertex_loop.push_back(v);
+                }
+            }
+            bounded_loops.push_back(vertex_loop);
+        }
+        loop_trip_counts.insert(loop_trip_counts.end(), fragment.loop_trip_counts.begin(),
+                                fragment.loop_trip_counts.end());
+    }
+}
+
+SearchingState runSearch(Module &M, TracePoint start_tp, TracePoint final_tp,
+                         SearchOptions options)
+{
+    auto searcher = TraceSearcher(M, options);
+    return searcher.search(start_tp, final_tp);
+}
+
+// "<start> <final>" per line, comments and empty lines aside
+bool readTracePointPairs(istream &in, vector<TracePointPair> &pairs)
+{
+    string line;
+    while (getline(in, line))
+    {
+        istringstream pair_stream(line);
+        TracePoint start_tp, final_tp;
+        if (!(pair_stream >> start_tp) || start_tp[0] == '#')
+        {
+            // empty line or comment
+            continue;
+        }
+        if (!(pair_stream >> final_tp))
+        {
+            cerr << "Bad tracepoint pair: " << line << "\n";
+            return false;
+        }
+        pairs.push_back({start_tp, final_tp});
+    }
+    return true;
+}
+
+// answer every pair with one graph build, write "<start> <final> <state>"
+// per pair and return union of all states
+int runBatchSearch(Module &M, const vector<TracePointPair> &pairs, ResultWriter &writer, SearchOptions options)
+{
+    auto searcher = TraceSearcher(M, options);
+    writer.graph(searcher.getGraph());
+    int ret = 0;
+
+    for (auto &[start_tp, final_tp] : pairs)
+    {
+        SearchingState state = searcher.search(start_tp, final_tp);
+        writer.result(start_tp, final_tp, state);
+        ret |= state.to_int();
+    }
+    return ret;
+}
+
+int runWcetSearch(Module &M, const vector<TracePointPair> &pairs, ResultWriter &writer, SearchOptions options)
+{
+    auto searcher = TraceSearcher(M, options);
+    writer.graph(searcher.getGraph());
+    int ret = 0;
+
+    for (auto &[start_tp, final_tp] : pairs)
+    {
+        CostEstimate estimate = searcher.worstCaseCost(start_tp, final_tp);
+        writer.result(start_tp, final_tp, estimate);
+        ret |= estimate.state.to_int();
+    }
+    return ret;
+}
+
+int runIncrementalSearch(Module &M, const string &state_path, vector<TracePointPair> pairs, bool matrix,
+                         ResultWriter &writer, SearchOptions options)
+{
+    if (options.cache_dir.empty())
+    {
+        options.cache_dir = state_path + ".fragments";
+    }
+    auto searcher = TraceSearcher(M, options);
+    writer.graph(searcher.getGraph());
+
+    ResultState previous;
+    ifstream previous_file(state_path);
+    if (previous_file && !previous.read(previous_file))
+    {
+        cerr << "Ignoring malformed state " << state_path << "\n";
+        previous = ResultState();
+    }
+
+    auto current = searcher.getState();
+    auto next = current;
+    auto plan = IncrementalPlan(previous, current, searcher.getCallees());
+
+    auto tracepoints = vector<TracePoint>();
+    if (matrix)
+    {
+        for (auto &[tp, fun] : current.label_function)
+        {
+            tracepoints.push_back(tp);
+        }
+        for (auto &start_tp : tracepoints)
+        {
+            for (auto &final_tp : tracepoints)
+            {
+                pairs.push_back({start_tp, final_tp});
+            }
+        }
+    }
+
+    int ret = 0;
+    for (auto &pair : pairs)
+    {
+        int verdict = plan.isReusable(pair)
+                          ? previous.verdicts.at(pair)
+                          : searcher.search(pair.first, pair.second).to_int();
+        next.verdicts[pair] = verdict;
+        ret |= verdict;
+    }
+    for (auto &[pair, verdict] : previous.verdicts)
+    {
+        if (plan.isReusable(pair))
+        {
+            next.verdicts.insert({pair, verdict});
+        }
+    }
+
+    if (matrix)
+    {
+        writer.matrix(tracepoints, [&](Index start, Index final) {
+            return SearchingState::from_int(next.verdicts[{tracepoints[start], tracepoints[final]}]);
+        });
+        ret = 0;
+    }
+    else
+    {
+        for (auto &[start_tp, final_tp] : pairs)
+        {
+            writer.result(start_tp, final_tp, SearchingState::from_int(next.verdicts[{start_tp, final_tp}]));
+        }
+    }
+
+    ofstream state_file(state_path);
+    next.write(state_file);
+    if (!state_file)
+    {
+        cerr << "Can't write " << state_path << "\n";
+        return 1;
+    }
+    return ret;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "analysis_cache.h"
+#include "compact_graph.h"
+#include "cost_model.h"
+#include "cycles_checker.h"
+#include "incremental.h"
+#include "result_writer.h"
+#include "searching_state.h"
+#include "stats.h"
+#include "trace_point_matrix.h"
+#include "wcet.h"
+
+// options of graph and bounded loops building
+struct SearchOptions
+{
+    // threads for per-function analyses, 0 means number of cores
+    unsigned workers = 1;
+    // report wall time of O1 pipeline per function to stderr
+    bool pipeline_timing = false;
+    // directory of cached fragments of functions, empty means no cache
+    std::string cache_dir;
+    // costs of instructions for worst-case cost estimation
+    CostModel costs;
+    // stages of graph building and checks are recorded if it's set
+    Stats *stats = nullptr;
+};
+
+// builds graph of Module and bounded loops once and answers searching
+// queries on them, so many tracepoint pairs can be checked per one run.
+// Module isn't referenced after construction.
+class TraceSearcher
+{
+private:
+    CompactGraph graph;
+    std::map<TracePoint, Vertex> label;
+    std::vector < std::vector<Vertex> > bounded_loops;
+    std::unique_ptr<CyclesChecker> cyclesChecker;
+
+    // costs of instructions of vertices and max trip counts of bounded
+    // loops, estimator is built by the first estimation
+    std::vector<uint64_t> vertex_cost;
+    std::vector<uint64_t> loop_trip_counts;
+    std::unique_ptr<WcetEstimator> wcetEstimator;
+
+    Stats *stats;
+
+    // functions are known by hash only if fragments are cached
+    ResultState state;
+    std::map<std::string, std::vector<std::string>> callees;
+
+public:
+    TraceSearcher(llvm::Module &M, SearchOptions options = SearchOptions());
+
+    SearchingState search(const TracePoint &start_tp, const TracePoint &final_tp);
+
+    // worst-case cost of trace from start_tp to final_tp, see WcetEstimator
+    CostEstimate worstCaseCost(const TracePoint &start_tp, const TracePoint &final_tp);
+
+    // the most hits of tracepoint in bounded loops around it, product of max
+    // trip counts of the loops. Further hits need a loop search() reports.
+    uint64_t iterationBound(const TracePoint &tp) const;
+
+    // states of all pairs of tracepoints at once
+    TracePointMatrix allPairs()
+    {
+        return TracePointMatrix(graph, label, bounded_loops);
+    }
+
+    std::vector<TracePoint> getTracePoints() const;
+
+    const CompactGraph &getGraph() const { return graph; }
+
+    // hashes of functions and places of tracepoints, without verdicts
+    ResultState getState() { return state; }
+
+    std::map<std::string, std::vector<std::string>> getCallees() { return callees; }
+
+private:
+    void joinFragments(const std::vector<llvm::Function *> &functions,
+                       const std::vector<FunctionFragment> &fragments);
+
+    // adds counters of the last check of cyclesChecker to stats
+    void countCheck();
+};
+
+// main function of searching loop in trace between start_tp and final_tp
+SearchingState runSearch(llvm::Module &M, TracePoint start_tp, TracePoint final_tp,
+                         SearchOptions options = SearchOptions());
+
+// pairs are separated by lines, empty lines and lines starting with '#' are
+// skipped
+bool readTracePointPairs(std::istream &in, std::vector<TracePointPair> &pairs);
+
+// writes graph and states of pairs, returns bitwise or of codes
+int runBatchSearch(llvm::Module &M, const std::vector<TracePointPair> &pairs, ResultWriter &writer,
+                   SearchOptions options = SearchOptions());
+
+// writes graph and costs of pairs, see printCost(), returns bitwise or of
+// states of estimates
+int runWcetSearch(llvm::Module &M, const std::vector<TracePointPair> &pairs, ResultWriter &writer,
+                  SearchOptions options = SearchOptions());
+
+// Checks pairs (all pairs of tracepoints for matrix) reusing verdicts of
+// previous run kept in `state_path', see IncrementalPlan. Fragments of
+// functions are cached next to the state unless cache is set explicitly.
+// State is rewritten with verdicts of the run and previous verdicts which
+// still hold.
+int runIncrementalSearch(llvm::Module &M, const std::string &state_path,
+                         std::vector<TracePointPair> pairs, bool matrix, ResultWriter &writer,
+                         SearchOptions options = SearchOptions());
@@ -1,3 +1,10 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
 typedef unsigned Vertex;
 typedef std::vector<std::vector<Vertex>> Graph;
-typedef std::string TracePoint;
\ No newline at end of file
+typedef std::string TracePoint;
+typedef unsigned Index;
+typedef Index Size;
@@ -1,65 +1,109 @@
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "types.h"
+#include "utils.h"
 
+#include <cstdio>
 #include <iostream>
 #include <map>
 
-void printGraph(Graph &graph, std::map<Vertex, Vertex> &calledFun)
+void printGraph(std::ostream &out, const CompactGraph &graph)
 {
-    std::cout << "Graph:" << std::endl;
+    out << "Graph:\n";
     for (Vertex v = 0; v < graph.size(); v++)
     {
-        std::cout << v << ":";
-        for (Vertex to : graph[v])
+        out << v << ":";
+        for (Vertex to : graph.successors(v))
         {
-            std::cout << " " << to;
+            out << " " << to;
         }
-        if (calledFun.find(v) != calledFun.end())
-            std::cout << " (" << calledFun[v] << ")";
-        std::cout << std::endl;
+        if (graph.hasCall(v))
+            out << " (" << graph.getCallee(v) << ")";
+        out << "\n";
     }
-    std::cout << std::endl;
+    out << "\n";
 }
 
-bool compareVertexLists(
-    std::vector<Vertex> VertexList1,
-    std::vector<Vertex> VertexList2)
+std::string jsonString(const std::string &str)
 {
-    if (VertexList1.size() != VertexList2.size())
+    std::string quoted = "\"";
+    for (char c : str)
     {
-        return false;
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+        {
+            quoted += c;
+        }
     }
+    return quoted + "\"";
+}
 
-    auto VertexList1Doubled = VertexList1;
-    auto old_count = VertexList1Doubled.size();
-    for (int i = 0; i < old_count; i++)
-    {
-        VertexList1Doubled.push_back(VertexList1Doubled[i]);
-    }
+std::string printType(llvm::Type *type)
+{
+    std::string name;
+    llvm::raw_string_ostream out(name);
+    type->print(out);
+    return out.str();
+}
+
+BoundedLoopIndex::BoundedLoopIndex(
+    Size amtVertices,
+    const std::vector<std::vector<Vertex>> &bounded_loops)
+    : outermost_header(amtVertices, NoHeader)
+{
+    // size of the loop each vertex is keyed by at the moment
+    std::vector<Size> loop_size(amtVertices, 0);
 
-    int i;
-    for (i = 0; i < VertexList1Doubled.size(); i++)
+    for (auto &bounded_loop : bounded_loops)
     {
-        if (VertexList1Doubled[i] == VertexList2[0])
+        if (bounded_loop.empty())
         {
-            break;
+            continue;
+        }
+        for (Vertex v : bounded_loop)
+        {
+            if (loop_size[v] < bounded_loop.size())
+            {
+                loop_size[v] = bounded_loop.size();
+                // the first block of the loop is its header
+                outermost_header[v] = bounded_loop[0];
+            }
         }
     }
-    if (i == VertexList1Doubled.size())
+}
+
+bool BoundedLoopIndex::isBounded(llvm::ArrayRef<Vertex> component) const
+{
+    if (component.empty())
     {
         return false;
     }
-    else
+
+    Vertex header = outermost_header[component[0]];
+    if (header == NoHeader)
     {
-        if (VertexList1Doubled.size() - i < VertexList2.size())
-            return false;
+        return false;
+    }
 
-        return std::equal(
-            VertexList2.begin(),
-            VertexList2.end(),
-            VertexList1Doubled.begin() + i);
+    for (Vertex v : component)
+    {
+        if (outermost_header[v] != header)
+        {
+            return false;
+        }
     }
+    return true;
 }
 
 // Left it here just in case
@@ -1,14 +1,43 @@
+#pragma once
+
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/IR/Type.h"
 
 #include "types.h"
+#include "compact_graph.h"
 
+#include <iostream>
 #include <map>
+#include <string>
+
+// Successors of every vertex, call edge in parentheses
+void printGraph(std::ostream &out, const CompactGraph &graph);
+
+// JSON string literal of `str' with quotes
+std::string jsonString(const std::string &str);
+
+// Type as it's printed in IR, e.g. to match indirect calls with functions
+std::string printType(llvm::Type *type);
+
+// Index of bounded loops. Every vertex is keyed by header of the outermost
+// bounded loop containing it (bounded loops are either nested or disjoint),
+// so set of vertices lies in one bounded loop iff all its vertices have the
+// same key, and check costs O(size of set) without any allocation.
+class BoundedLoopIndex
+{
+private:
+    enum : Vertex { NoHeader = ~0u };
+
+    std::vector<Vertex> outermost_header;
 
-void printGraph(Graph &graph, std::map<Vertex, Vertex> &calledFun);
+public:
+    BoundedLoopIndex(Size amtVertices,
+                     const std::vector<std::vector<Vertex>> &bounded_loops);
 
-bool compareVertexLists(
-    std::vector<Vertex> VertexList1,
-    std::vector<Vertex> VertexList2);
+    // Check if all vertices of `component' belong to the same bounded loop
+    bool isBounded(llvm::ArrayRef<Vertex> component) const;
+};
 
 bool compareBlocks(const llvm::BasicBlock *BBL,
                    const llvm::BasicBlock *BBR);
@@ -0,0 +1,235 @@
+#include "wcet.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+static uint64_t addCost(uint64_t a, uint64_t b)
+{
+    if (a == WcetEstimator::Unbounded || b == WcetEstimator::Unbounded || a + b < a)
+    {
+        return WcetEstimator::Unbounded;
+    }
+    return a + b;
+}
+
+static uint64_t mulCost(uint64_t times, uint64_t a)
+{
+    if (a == WcetEstimator::Unbounded || (a != 0 && times > (WcetEstimator::Unbounded - 1) / a))
+    {
+        return WcetEstimator::Unbounded;
+    }
+    return times * a;
+}
+
+WcetEstimator::WcetEstimator(const CompactGraph &graph_,
+                             const vector<uint64_t> &cost_,
+                             const vector<vector<Vertex>> &bounded_loops_,
+                             const vector<uint64_t> &trip_counts_)
+    : graph(graph_),
+      cost(cost_),
+      bounded_loops(bounded_loops_),
+      trip_counts(trip_counts_),
+      finder(graph_)
+{
+    // bounded loops are either nested or disjoint, so the smaller loop
+    // containing vertex is the inner one
+    auto by_size = vector<Index>(bounded_loops.size());
+    iota(by_size.begin(), by_size.end(), 0);
+    stable_sort(by_size.begin(), by_size.end(),
+                [&](Index a, Index b) { return bounded_loops[a].size() < bounded_loops[b].size(); });
+    containing.assign(graph.size(), {});
+    for (Index loop : by_size)
+    {
+        for (Vertex v : bounded_loops[loop])
+        {
+            containing[v].push_back(loop);
+        }
+    }
+    subloops.assign(bounded_loops.size(), {});
+    for (Index loop = 0; loop < bounded_loops.size(); loop++)
+    {
+        auto &outer = containing[bounded_loops[loop][0]];
+        auto it = find(outer.begin(), outer.end(), loop);
+        if (it + 1 != outer.end())
+        {
+            subloops[*(it + 1)].push_back(loop);
+        }
+    }
+    loop_cost.assign(bounded_loops.size(), 0);
+    loop_costed.assign(bounded_loops.size(), false);
+
+    // costs up to return don't depend on queries, called functions are
+    // completed before their callers
+    auto all_vertices = vector<Vertex>(graph.size());
+    iota(all_vertices.begin(), all_vertices.end(), 0);
+    finder.run(all_vertices);
+    auto &components = finder.getComponents();
+    whole.assign(graph.size(), Unbounded);
+    for (Index c = 0; c < components.size(); c++)
+    {
+        uint64_t after = 0;
+        for (Vertex v : components[c])
+        {
+            for (Vertex to : graph.successors(v))
+            {
+                if (finder.getComponent(to) != c)
+                {
+                    after = max(after, whole[to]);
+                }
+            }
+        }
+        auto result = addCost(componentCost(c), after);
+        for (Vertex v : components[c])
+        {
+            whole[v] = result;
+        }
+    }
+}
+
+uint64_t WcetEstimator::vertexCost(Vertex v) const
+{
+    return addCost(cost[v], graph.hasCall(v) ? whole[graph.getCallee(v)] : 0);
+}
+
+Index WcetEstimator::commonLoop(const vector<Vertex> &component) const
+{
+    for (Index loop : containing[component[0]])
+    {
+        bool common = all_of(component.begin(), component.end(), [&](Vertex v) {
+            return find(containing[v].begin(), containing[v].end(), loop) != containing[v].end();
+        });
+        if (common)
+        {
+            return loop;
+        }
+    }
+    return NoGroup;
+}
+
+uint64_t WcetEstimator::loopCost(Index loop)
+{
+    // loops are costed once, when their component is completed
+    if (loop_costed[loop])
+    {
+        return loop_cost[loop];
+    }
+    loop_costed[loop] = true;
+
+    uint64_t body = 0;
+    for (Vertex v : bounded_loops[loop])
+    {
+        if (containing[v].front() == loop)
+        {
+            body = addCost(body, vertexCost(v));
+        }
+    }
+    for (Index subloop : subloops[loop])
+    {
+        body = addCost(body, loopCost(subloop));
+    }
+    return loop_cost[loop] = mulCost(trip_counts[loop], body);
+}
+
+uint64_t WcetEstimator::componentCost(Index c)
+{
+    auto &component = finder.getComponents()[c];
+    if (!finder.isCyclic(c))
+    {
+        return vertexCost(component[0]);
+    }
+
+    for (Vertex v : component)
+    {
+        if (graph.hasCall(v) && finder.getComponent(graph.getCallee(v)) == c)
+        {
+            // recursion
+            return Unbounded;
+        }
+    }
+    Index loop = commonLoop(component);
+    return loop == NoGroup ? Unbounded : loopCost(loop);
+}
+
+bool WcetEstimator::estimate(Vertex start_v, Vertex final_v, const CyclesChecker &checker, uint64_t &result)
+{
+    if (start_v == final_v)
+    {
+        result = 0;
+        return true;
+    }
+
+    // final vertex has no edges on trace, so it's left out of components
+    finder.run({start_v}, [&](Vertex v) { return v != final_v; },
+               [&](Vertex v) { return checker.skipsBranches(v) ? 1 : graph.amtTraceEdges(v); });
+    auto &components = finder.getComponents();
+    reached.assign(components.size(), false);
+    to_final.assign(components.size(), 0);
+
+    for (Index c = 0; c < components.size(); c++)
+    {
+        // worst-case cost after leaving component to reach final vertex
+        bool reaches = false;
+        uint64_t after = 0;
+        auto leave = [&](Vertex to) {
+            if (to == final_v)
+            {
+                reaches = true;
+                return;
+            }
+            auto d = finder.getComponent(to);
+            if (d != c && reached[d])
+            {
+                reaches = true;
+                after = max(after, to_final[d]);
+            }
+        };
+
+        for (Vertex v : components[c])
+        {
+            if (graph.hasCall(v))
+            {
+                leave(graph.getCallee(v));
+            }
+            if (!checker.skipsBranches(v))
+            {
+                for (Vertex to : graph.successors(v))
+                {
+                    leave(to);
+                }
+            }
+        }
+        if (reaches)
+        {
+            // the called function of vertex out of loop is entered instead
+            // of being executed up to its return
+            Vertex v = components[c][0];
+            bool enters = !finder.isCyclic(c) && checker.skipsBranches(v);
+            reached[c] = true;
+            to_final[c] = addCost(enters ? cost[v] : componentCost(c), after);
+        }
+    }
+
+    auto c = finder.getComponent(start_v);
+    result = to_final[c];
+    return reached[c];
+}
+
+string printCost(const CostEstimate &estimate)
+{
+    auto &state = estimate.state;
+    if (state.StartTPNotFound || state.FinalTPNotFound)
+    {
+        return "not found";
+    }
+    if (state.FinalTPUnreachable)
+    {
+        return "unreachable";
+    }
+    if (state.LoopFound)
+    {
+        return "unbounded";
+    }
+    return to_string(estimate.cost);
+}
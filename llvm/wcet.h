@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "compact_graph.h"
+#include "cycles_checker.h"
+#include "scc.h"
+#include "searching_state.h"
+
+// estimate worst-case cost of traces
+//
+// Cost of vertex is cost of its instructions and, if it calls a function,
+// worst-case cost of the called function up to its return. Graph is
+// condensed into components (call edges included), which are processed in
+// reverse topological order, so worst-case cost of path over the DAG of
+// components is found by one sweep. Bounded loop costs its max trip count
+// times cost of its body: cost of its vertices which aren't in subloops and
+// costs of subloops. Costs of all vertices of body are summed, as if every
+// vertex were executed in every iteration. Any other cycle, recursion
+// included, makes cost unbounded.
+//
+// Trace between tracepoints ends when it reaches final vertex, so cycles
+// through it aren't taken. Trace which reaches final vertex in called
+// function doesn't return from it, so the estimate is made on the part of
+// graph CyclesChecker explores for the same pair.
+class WcetEstimator
+{
+public:
+    enum : uint64_t { Unbounded = ~0ull };
+
+private:
+    enum : Index { NoGroup = ~0u };
+
+    const CompactGraph &graph;
+    const std::vector<uint64_t> &cost;
+    const std::vector<std::vector<Vertex>> &bounded_loops;
+    const std::vector<uint64_t> &trip_counts;
+
+    SCCFinder finder;
+
+    // bounded loops containing vertex, innermost first
+    std::vector<std::vector<Index>> containing;
+    std::vector<std::vector<Index>> subloops;
+    std::vector<uint64_t> loop_cost;
+    std::vector<bool> loop_costed;
+    // worst-case cost from vertex up to return of its function
+    std::vector<uint64_t> whole;
+
+    std::vector<bool> reached;
+    std::vector<uint64_t> to_final;
+
+public:
+    WcetEstimator(const CompactGraph &graph_,
+                  const std::vector<uint64_t> &cost_,
+                  const std::vector<std::vector<Vertex>> &bounded_loops_,
+                  const std::vector<uint64_t> &trip_counts_);
+
+    // false if `final_v' isn't reachable from `start_v', otherwise `result'
+    // is worst-case cost of trace from `start_v' to `final_v' or Unbounded.
+    // `checker' has just checked the same pair, branches it didn't take
+    // aren't taken either.
+    bool estimate(Vertex start_v, Vertex final_v, const CyclesChecker &checker, uint64_t &result);
+
+private:
+    // cost of vertex with the called function
+    uint64_t vertexCost(Vertex v) const;
+
+    // the innermost bounded loop containing all vertices of `component'
+    Index commonLoop(const std::vector<Vertex> &component) const;
+
+    uint64_t loopCost(Index loop);
+
+    // cost of component of the last run of finder, executed once
+    uint64_t componentCost(Index c);
+};
+
+// worst-case cost of trace between tracepoints, state tells if they are
+// found, if final one is reachable and if cost is unbounded (LoopFound)
+struct CostEstimate
+{
+    SearchingState state;
+    uint64_t cost;
+};
+
+// cost, "unbounded", "unreachable" or "not found"
+std::string printCost(const CostEstimate &estimate);